@@ -0,0 +1,45 @@
+# Generates a C++ key entry table from linux/input-event-codes.h.
+# Usage: cmake -DINPUT_HEADER=<input-event-codes.h> -DOUTPUT_HEADER=<LinuxKeyCodes.h> -P GenerateKeyCodes.cmake
+#
+# Every KEY_* and BTN_* code is emitted under its kernel name. Aliases (e.g. BTN_A -> BTN_SOUTH)
+# follow the names they refer to, so lookups by code return the primary name.
+
+if (NOT INPUT_HEADER OR NOT OUTPUT_HEADER)
+    message(FATAL_ERROR "INPUT_HEADER and OUTPUT_HEADER must be set")
+endif()
+
+file(STRINGS "${INPUT_HEADER}" DEFINE_LINES REGEX "^#define[ \t]+(KEY|BTN)_[A-Z0-9_]+[ \t]+[A-Za-z0-9_]+")
+
+set(PRIMARY_ENTRIES "")
+set(ALIAS_ENTRIES "")
+foreach (LINE IN LISTS DEFINE_LINES)
+    string(REGEX REPLACE "^#define[ \t]+([A-Z0-9_]+)[ \t]+([A-Za-z0-9_]+).*$" "\\1;\\2" PAIR "${LINE}")
+    list(GET PAIR 0 NAME)
+    list(GET PAIR 1 VALUE)
+
+    if (NAME MATCHES "^(KEY_RESERVED|KEY_MAX|KEY_CNT|KEY_MIN_INTERESTING|BTN_MISC|BTN_MOUSE|BTN_JOYSTICK|BTN_GAMEPAD|BTN_DIGI|BTN_WHEEL|BTN_TRIGGER_HAPPY)$")
+        continue()
+    endif()
+
+    if (VALUE MATCHES "^(0x[0-9a-fA-F]+|[0-9]+)$")
+        math(EXPR CODE "${VALUE}")
+        set(CODE_${NAME} ${CODE})
+        string(APPEND PRIMARY_ENTRIES "    {\"${NAME}\", ${CODE}},\n")
+    elseif (DEFINED CODE_${VALUE})
+        string(APPEND ALIAS_ENTRIES "    {\"${NAME}\", ${CODE_${VALUE}}},\n")
+    endif()
+endforeach()
+
+set(CONTENT "// Generated from ${INPUT_HEADER} by cmake/GenerateKeyCodes.cmake. Do not edit.\n\n")
+string(APPEND CONTENT "#ifndef OTTO_LINUXKEYCODES_H\n#define OTTO_LINUXKEYCODES_H\n\n#include \"KeyTable.h\"\n\n")
+string(APPEND CONTENT "static constexpr KeyEntry LinuxKeyEntries[] = {\n${PRIMARY_ENTRIES}${ALIAS_ENTRIES}};\n\n")
+string(APPEND CONTENT "#endif // OTTO_LINUXKEYCODES_H\n")
+
+# Only touch the output when it changes, to avoid needless rebuilds.
+if (EXISTS "${OUTPUT_HEADER}")
+    file(READ "${OUTPUT_HEADER}" EXISTING)
+    if (EXISTING STREQUAL CONTENT)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT_HEADER}" "${CONTENT}")
@@ -21,16 +21,31 @@
 #define OTTO_APPEXECUTOR_H
 
 #include "BaseExecutor.h"
+#include "Timeline.h"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 /**
- * Executes commands to launch and close applications using HTTP requests.
+ * Executes commands to launch and close applications using HTTP requests. The requests are sent
+ * by the HttpRequester, and the script waits for them without holding its thread. On a
+ * simulated timeline no request is made; only the time the app is given to settle passes.
  */
 class AppExecutor : public BaseExecutor {
 public:
-    AppExecutor() = default;
+    /**
+     * Constructs an AppExecutor.
+     *
+     * @param timeline The script's timeline, on which apps are given time to settle.
+     */
+    explicit AppExecutor(Timeline &timeline);
+
+    /**
+     * Cancels a request that is still outstanding, so it cannot wake a script that is gone.
+     */
+    ~AppExecutor() override;
 
     /**
      * Executes the launch or close app commands.
@@ -41,12 +56,11 @@ public:
     void execute(const std::vector<std::string> &args) override;
 
 private:
-    /**
-     * Sends an HTTP request using `curl` to the specified URL.
-     *
-     * @param url The URL for the HTTP request.
-     */
-    void sendHttpRequest(const std::string &url);
+    static constexpr int AppSettleMs = 5000; ///< Time given to an app to launch or close.
+    static constexpr size_t NoRequest = SIZE_MAX;
+
+    Timeline &timeline;
+    size_t requestId = NoRequest; ///< The outstanding request of the script, or NoRequest.
 };
 
 #endif // OTTO_APPEXECUTOR_H
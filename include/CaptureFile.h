@@ -0,0 +1,85 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_CAPTUREFILE_H
+#define OTTO_CAPTUREFILE_H
+
+#include "InputRecord.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+/**
+ * CaptureFile gives read-only, memory-mapped access to a binary capture file.
+ */
+class CaptureFile {
+public:
+    /**
+     * Maps a capture file into memory and validates its header.
+     *
+     * @param filePath The path to the capture file.
+     * @throws std::runtime_error If the file cannot be mapped or is not a capture file.
+     */
+    explicit CaptureFile(const std::string &filePath);
+
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile &) = delete;
+    CaptureFile &operator=(const CaptureFile &) = delete;
+
+    /**
+     * Checks whether a file starts with the binary capture header.
+     *
+     * @param filePath The path to the file.
+     * @return True if the file is a binary capture file.
+     */
+    static bool isCaptureFile(const std::string &filePath);
+
+    /**
+     * Advances to the next event record, collecting any metadata records passed on the way.
+     *
+     * @param index The record index to start from; updated to point past the returned record.
+     * @return The next event record, or nullptr at the end of the file.
+     */
+    const InputRecord *next(size_t &index);
+
+    /**
+     * Returns the names of the devices described so far, keyed by device id.
+     */
+    const std::map<uint16_t, std::string> &getDeviceNames() const;
+
+    /**
+     * Returns the capabilities of the devices described so far, keyed by device id. Only raw
+     * captures describe device capabilities.
+     */
+    const std::map<uint16_t, CaptureDeviceCapabilities> &getDeviceCapabilities() const;
+
+private:
+    void readMetadata(const InputRecord &record, size_t payloadIndex);
+
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    const InputRecord *records = nullptr;
+    size_t recordCount = 0;
+    std::map<uint16_t, std::string> deviceNames;
+    std::map<uint16_t, CaptureDeviceCapabilities> deviceCapabilities;
+};
+
+#endif // OTTO_CAPTUREFILE_H
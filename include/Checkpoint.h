@@ -0,0 +1,82 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_CHECKPOINT_H
+#define OTTO_CHECKPOINT_H
+
+#include "Timeline.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Checkpoint is the execution state of a script between two commands: enough to continue a
+ * long run where it stopped instead of from the start. It is stored as a small text file:
+ *
+ *     otto-checkpoint 1
+ *     script 9f3c2a61d08e4b57
+ *     command 42
+ *     elapsed 3912000
+ *     timeline relative
+ *     loop 3 117
+ *     held 42
+ *     var app YouTube
+ *
+ * with one "loop <start index> <remaining iterations>" line per open loop, outermost first,
+ * and one line per key held down and per variable.
+ */
+struct Checkpoint {
+    uint64_t scriptHash = 0;  ///< Identifies the commands the checkpoint belongs to; see hashCommands().
+    size_t commandIndex = 0;  ///< The command to execute next.
+    int64_t elapsedMs = 0;    ///< Script time spent before the checkpoint.
+    Timeline::Mode mode = Timeline::Mode::Relative;
+    std::vector<std::pair<int, int>> loops;
+    std::vector<int> heldKeys;
+    std::unordered_map<std::string, std::string> variables;
+
+    /**
+     * Writes the checkpoint, replacing the file atomically so that a crash leaves either the old
+     * or the new checkpoint behind.
+     *
+     * @param filePath The checkpoint file.
+     * @throws std::runtime_error If the file cannot be written.
+     */
+    void save(const std::string &filePath) const;
+
+    /**
+     * Reads a checkpoint.
+     *
+     * @param filePath The checkpoint file.
+     * @param checkpoint Set to the checkpoint read.
+     * @return False if there is no checkpoint file.
+     * @throws std::runtime_error If the file is not a valid checkpoint.
+     */
+    static bool load(const std::string &filePath, Checkpoint &checkpoint);
+
+    /**
+     * Hashes parsed commands, so a checkpoint is not applied to a commands file that has changed.
+     */
+    static uint64_t hashCommands(const std::vector<std::vector<std::string>> &commands);
+};
+
+#endif // OTTO_CHECKPOINT_H
@@ -54,6 +54,14 @@ public:
      */
     std::shared_ptr<BaseExecutor> getExecutor(const std::string &command);
 
+    /**
+     * Checks whether a command is registered, without logging a miss.
+     *
+     * @param command The name of the command.
+     * @return True if an executor is registered for the command.
+     */
+    bool hasCommand(const std::string &command) const;
+
     /**
      * Executes a command by delegating it to the appropriate executor.
      *
@@ -69,9 +77,18 @@ public:
     void setParsedCommands(const std::vector<std::vector<std::string>> &commands);
 
     /**
-     * Executes all parsed commands from the current index.
+     * Retrieves the parsed commands, e.g. for executors that look ahead at a block.
+     *
+     * @return The list of commands.
+     */
+    const std::vector<std::vector<std::string>> &getParsedCommands() const;
+
+    /**
+     * Executes the command at the current index and moves to the next one.
+     *
+     * @return False if there was no command left to execute.
      */
-    void executeAll();
+    bool step();
 
     /**
      * Retrieves the current command index.
@@ -27,8 +27,9 @@
 #include <vector>
 
 /**
- * CommandHandler parses a commands file and delegates command execution
- * to the CommandExecutor.
+ * CommandHandler parses a commands file and hands the commands to the CommandExecutor.
+ * Included files and subroutine calls are inlined while parsing, so the executor only sees
+ * plain commands. Scripts are executed by a ScriptTask.
  */
 class CommandHandler {
 public:
@@ -47,9 +48,18 @@ public:
     void parseFile(const std::string &filePath);
 
     /**
-     * Executes all parsed commands.
+     * Parses a file containing commands without handing them to an executor, e.g. to split it.
+     * Each file is read once per process for as long as it is unchanged, so a library that many
+     * scripts include is only parsed once.
+     *
+     * @param filePath The path to the commands file.
+     * @param files If not null, the commands file and every file it includes are added to it,
+     *              also the ones read before a parse error.
+     * @return The commands, one list of arguments each.
+     * @throws std::runtime_error If a file cannot be read, a line is invalid or a subroutine is misused.
      */
-    void executeCommands();
+    static std::vector<std::vector<std::string>> parseCommands(const std::string &filePath,
+                                                               std::vector<std::string> *files = nullptr);
 
 private:
     std::shared_ptr<CommandExecutor> executor;
@@ -0,0 +1,98 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_DEVICEFILTER_H
+#define OTTO_DEVICEFILTER_H
+
+#include <bitset>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Identity and capabilities of an evdev input device, as reported by its ioctls.
+ */
+struct InputDeviceInfo {
+    static constexpr size_t KeyBitCount = 0x300; ///< KEY_CNT
+
+    std::string path;
+    std::string name;
+    std::string phys;
+    uint32_t eventTypes = 0;           ///< Bit n set if the device reports event type n (EV_KEY, EV_REL, ...).
+    std::bitset<KeyBitCount> keyCodes; ///< Key codes the device can report.
+
+    /**
+     * Queries an open evdev device for its name, physical path and capabilities.
+     *
+     * @param fd An open file descriptor for the device.
+     * @param path The device node path.
+     * @return The device information; fields the device does not report are left empty.
+     */
+    static InputDeviceInfo probe(int fd, const std::string &path);
+};
+
+/**
+ * DeviceFilter selects which input devices are captured, using include and exclude rules.
+ *
+ * A rule has the form "[+|-]<field>:<pattern>", where field is one of:
+ *   name  - glob matched against the device name (EVIOCGNAME)
+ *   phys  - glob matched against the physical path (EVIOCGPHYS)
+ *   path  - glob matched against the device node, e.g. /dev/input/event3
+ *   cap   - event type the device must report, e.g. EV_KEY, EV_REL or a number
+ *   key   - key the device must be able to send, as a key map name or key code
+ *
+ * Rules default to include. A device is selected if it matches at least one include rule
+ * (or there are none) and no exclude rule.
+ */
+class DeviceFilter {
+public:
+    /**
+     * Parses and adds a rule.
+     *
+     * @param rule The rule text, e.g. "-name:*Power Button*".
+     * @throws std::invalid_argument If the rule cannot be parsed.
+     */
+    void addRule(const std::string &rule);
+
+    /**
+     * Checks whether a device should be captured.
+     *
+     * @param device The probed device.
+     * @return True if the device passes the rules.
+     */
+    bool matches(const InputDeviceInfo &device) const;
+
+    bool empty() const;
+
+private:
+    enum class Field { Name, Phys, Path, Capability, Key };
+
+    struct Rule {
+        bool include;
+        Field field;
+        std::string pattern;
+        int number; ///< Event type or key code for Capability and Key rules.
+    };
+
+    static bool ruleMatches(const Rule &rule, const InputDeviceInfo &device);
+
+    std::vector<Rule> rules;
+};
+
+#endif // OTTO_DEVICEFILTER_H
@@ -20,80 +20,236 @@
 #ifndef OTTO_EVENTMANAGER_H
 #define OTTO_EVENTMANAGER_H
 
+#include "DeviceFilter.h"
+#include "InjectionQueue.h"
 #include "KeyMap.h"
+#include "LatencyHistogram.h"
+#include "RecordWriter.h"
 
 #include <atomic>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#ifdef ENABLE_UINPUT
+struct input_event;
+#endif
+
+/**
+ * Options controlling what is captured during a recording session.
+ */
+struct RecordOptions {
+    RecordFormat format = RecordFormat::Text;    ///< Output format of the recording.
+    int debounceMs = 0;                          ///< Default debounce window for repeated presses; 0 disables it.
+    std::map<std::string, int> deviceDebounceMs; ///< Per-device overrides, keyed by device path or name.
+    DeviceFilter deviceFilter;                   ///< Selects which evdev devices are captured.
+    bool rawEvents = false; ///< Capture every evdev event and the device capabilities; binary format only.
+    bool mirror = false;    ///< Forward captured key events to the output device as they arrive.
+    std::unordered_map<int, int> mirrorKeyMap; ///< Key codes replaced while mirroring.
+};
+
 /**
  * EventManager handles sending and recording key events using uinput/evdev (direct) or libuinput (via IARMUtils).
+ *
+ * Key events can be sent from any thread. They are queued per sending thread and written to
+ * the output device by a single injector thread, which owns the device, so concurrent senders
+ * never interleave inside a report and each sender's events keep their order.
  */
 class EventManager {
 public:
     static EventManager &getInstance();
 
     /**
-     * Sends a key event.
+     * Sets how many virtual output devices are created, e.g. one per parallel script.
+     * Takes effect only if called before the first getInstance().
+     *
+     * @param count The number of output devices; at least one is always created.
+     */
+    static void setOutputDeviceCount(size_t count);
+
+    static size_t getOutputDeviceCount();
+
+    /**
+     * Sends a key event. Thread safe; returns once the event is queued for the injector thread.
      *
      * @param keyType The type of the key event, press or release.
      * @param keyCode The key code to send.
+     * @param outputDevice Index of the output device to send to. IR events all go to the IR bus.
+     */
+    void sendEvent(int keyType, int keyCode, size_t outputDevice = 0);
+
+    /**
+     * Sends several key events as one synchronized report, so they are seen as simultaneous.
+     * With uinput the whole report is written at once; IR events are dispatched in order.
+     * Thread safe; returns once the events are queued for the injector thread.
+     *
+     * @param events The key events to send.
+     * @param outputDevice Index of the output device to send to.
      */
-    void sendEvent(int keyType, int keyCode);
+    void sendEvents(const std::vector<KeyEvent> &events, size_t outputDevice = 0);
 
     /**
-     * Starts recording key events to a specified file.
+     * Starts recording key events to a specified file, and/or mirroring them to the output device.
      *
-     * @param outputFile The path to the output file for recording.
+     * @param outputFile The path to the output file for recording; empty to only mirror events.
+     * @param options Capture options for the session.
      */
-    void startRecording(const std::string &outputFile);
+    void startRecording(const std::string &outputFile, const RecordOptions &options = RecordOptions());
 
     /**
-     * Stops the ongoing recording and saves events to the file.
+     * Stops the ongoing recording and flushes any remaining events to the file.
      */
     void stopRecording();
 
     /**
      * Handles incoming events for recording.
      *
+     * @param deviceId The id of the device that produced the event.
      * @param keyType The type of the key event.
      * @param keyCode The key code of the event.
+     * @param timestampUs The time the event occurred, in microseconds.
+     */
+    void handleEvent(uint16_t deviceId, int keyType, int keyCode, int64_t timestampUs);
+
+    /**
+     * Called for every key event captured from the input devices.
+     */
+    using KeyListener = std::function<void(int keyType, int keyCode)>;
+
+    /**
+     * Registers a key listener, starting the capture from the input devices if it is not
+     * running yet. The capture keeps running for CaptureLingerMs after the last listener is
+     * removed, so consecutive waits for a key reuse it. Listeners only hear the devices
+     * selected by setListenDeviceFilter(), also while a recording captures other devices.
+     * Listeners are called on the capture thread and must return quickly. Thread safe.
+     *
+     * @param listener The listener.
+     * @return An id to remove the listener with.
      */
-    void handleEvent(int keyType, int keyCode);
+    size_t addKeyListener(KeyListener listener);
+
+    /**
+     * Removes a key listener. Once this returns the listener is not running and is not called
+     * again. Thread safe.
+     *
+     * @param listenerId The id returned by addKeyListener().
+     */
+    void removeKeyListener(size_t listenerId);
+
+    /**
+     * Selects the input devices captured for key listeners while not recording.
+     *
+     * @param filter The device rules.
+     */
+    static void setListenDeviceFilter(const DeviceFilter &filter);
 
 private:
+    static constexpr int IdleWaitMs = 500;        ///< Longest sleep of the idle injector thread.
+    static constexpr int CaptureLingerMs = 5000; ///< Capture kept without listeners or recording.
+
+    static size_t outputDeviceCount;
+    static DeviceFilter listenDeviceFilter;
+
     EventManager();
     ~EventManager();
 
     EventManager(const EventManager &) = delete;
     EventManager &operator=(const EventManager &) = delete;
 
-    void writeRecordedEventsToFile();
+    /**
+     * Per-device state of the capture thread: what the device is captured for, and the state
+     * used to debounce repeated presses.
+     */
+    struct CaptureDeviceState {
+        bool recorded = false; ///< Selected by the recording's device filter.
+        bool listened = false; ///< Selected by the key listeners' device filter.
+        int debounceMs = 0;
+        std::unordered_map<int, int64_t> lastDownUs; ///< Last accepted press per key code.
+        std::unordered_set<int> suppressedKeys;      ///< Keys whose current press was debounced.
+    };
+
+    void enqueueEvents(const KeyEvent *events, size_t count, size_t outputDevice, int64_t captureUs = -1);
+    void injectorLoop();
+    void stopInjector();
+    void injectReport(const InjectionReport &report);
+
+    void mirrorEvent(int keyType, int keyCode, int64_t timestampUs);
+    void notifyKeyListeners(int keyType, int keyCode);
+
+    /**
+     * (Re)starts capturing key events from the input devices selected by the recording's
+     * filter, if recording, and by the key listeners' filter. Must be called with captureMutex
+     * held.
+     */
+    void startCapture();
+
+    /**
+     * Stops capturing key events. Must be called with captureMutex held.
+     */
+    void stopCapture();
+
+    uint16_t addCaptureDevice(const std::string &path, const std::string &name, bool recorded, bool listened,
+                              const CaptureDeviceCapabilities *capabilities = nullptr);
 
 #ifdef ENABLE_UINPUT
-    void sendUInputEvent(int keyType, int keyCode);
+    struct EvdevDevice {
+        std::string path;
+        uint16_t id;
+    };
+
+    void sendUInputEvents(size_t outputDevice, const KeyEvent *events, size_t count);
     void setupUInput();
+    int createUInputDevice(const std::string &name, uint16_t index);
     void cleanupUInput();
+    int openInputDevice(const std::string &devicePath);
+    bool isInputDeviceOpen(const std::string &devicePath);
+    void closeInputDevice(int fd);
     void discoverInputDevices();
+    bool handleHotplug(int inotifyFd);
     void stopEvdevThread();
     void evdevRecordingLoop();
+    void handleRawEvents(uint16_t deviceId, const struct input_event *events, size_t count);
 
-    int uinputFd = -1;
+    std::vector<int> uinputFds; ///< One per output device.
     std::atomic<bool> isEvdevRecording{false};
-    std::map<int, std::string> evdevDevices;
+    std::atomic<bool> hasCaptureEnded{false}; ///< The capture thread ended on its own; restart it to capture.
+    std::map<int, EvdevDevice> evdevDevices;
+    DeviceFilter deviceFilter; ///< Devices recorded, while recording.
+    DeviceFilter listenFilter; ///< Devices heard by key listeners.
     std::thread evdevRecordingThread;
 #else
     void sendLibUInputEvent(int keyType, int keyCode);
+
+    static constexpr uint16_t IRDeviceId = 0; ///< The only capture device without evdev.
+
+    bool isIRHandlerRegistered = false;
 #endif
 
     std::atomic<bool> isRecording{false};
     std::string recordFilePath;
-    std::vector<std::string> recordedEvents;
+    RecordOptions recordOptions;
+    std::vector<CaptureDeviceState> captureDevices; ///< Indexed by device id; IR events hold recordingMutex.
+    std::map<std::string, uint16_t> captureDeviceIds; ///< Device id by path and name, reused on reconnect.
     std::mutex recordingMutex;
+    std::mutex captureMutex; ///< Serializes starting and stopping the capture.
+    bool isCapturing = false;
+    std::mutex listenerMutex;
+    std::map<size_t, KeyListener> keyListeners; ///< Guarded by listenerMutex.
+    size_t nextListenerId = 0;
+    std::atomic<bool> hasKeyListeners{false};
+    InjectionQueue injectionQueue;
+    std::atomic<bool> isInjecting{false};
+    std::thread injectorThread;
+    std::mutex latencyMutex;
+    LatencyHistogram mirrorLatency; ///< Capture-to-injection latency, guarded by latencyMutex.
     KeyMap keyMap;
+    RecordWriter recordWriter{keyMap};
 };
 
 #endif // OTTO_EVENTMANAGER_H
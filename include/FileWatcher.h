@@ -0,0 +1,81 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_FILEWATCHER_H
+#define OTTO_FILEWATCHER_H
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * FileWatcher waits for any of a set of files to change, sleeping on inotify. The directories
+ * of the files are watched rather than the files themselves, so files that editors save by
+ * replacing them are still seen. Changes made while nobody is waiting are reported by the
+ * next wait.
+ */
+class FileWatcher {
+public:
+    /**
+     * @throws std::runtime_error if inotify is unavailable.
+     */
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    /**
+     * Replaces the files watched.
+     *
+     * @param files The files; they need not exist yet, but their directories must.
+     * @throws std::runtime_error if a directory cannot be watched.
+     */
+    void watch(const std::vector<std::string> &files);
+
+    /**
+     * Waits until a watched file is written, created, replaced or removed, and then until no
+     * file has changed for SettleMs, so that a save made of several writes is seen once.
+     *
+     * @param stop Checked every StopCheckMs; the wait ends without a change once it is set.
+     * @return The path of the first file that changed, or empty if stopped.
+     * @throws std::runtime_error if reading the events fails.
+     */
+    std::string waitForChange(const std::atomic<bool> &stop);
+
+private:
+    static constexpr int SettleMs = 100;
+    static constexpr int StopCheckMs = 100;
+
+    /**
+     * Reads the pending events.
+     *
+     * @param timeoutMs How long to wait for events.
+     * @return The path of the first watched file changed, or empty if none was.
+     */
+    std::string readChanges(int timeoutMs);
+
+    int inotifyFd = -1;
+    std::map<int, std::string> directories;         ///< Directory by inotify watch descriptor.
+    std::set<std::pair<int, std::string>> watched; ///< Watch descriptor and name of each file.
+};
+
+#endif // OTTO_FILEWATCHER_H
@@ -0,0 +1,99 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_HTTPREQUESTER_H
+#define OTTO_HTTPREQUESTER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+/**
+ * HttpRequester sends the HTTP requests of all scripts from one worker thread, so a script that
+ * waits for a request does not hold a thread of its own. Each request runs `curl` as a child
+ * process; requests are sent one at a time in the order they were made. On destruction the
+ * running request is killed and the worker is joined.
+ */
+class HttpRequester {
+public:
+    static HttpRequester &getInstance();
+
+    /**
+     * Called on the worker thread once a request has completed; must return quickly.
+     *
+     * @param status The exit code of `curl`, 0 on success, or -1 if it could not run.
+     */
+    using CompletionListener = std::function<void(int status)>;
+
+    /**
+     * Queues a POST request with an empty body. Thread safe.
+     *
+     * @param url The URL to post to.
+     * @param listener Called once the request has completed.
+     * @return An id to cancel the request with.
+     */
+    size_t post(const std::string &url, CompletionListener listener);
+
+    /**
+     * Cancels a request. Once this returns its listener is not running and is not called again;
+     * a request that is already being sent still completes. Thread safe.
+     *
+     * @param requestId The id returned by post().
+     */
+    void cancel(size_t requestId);
+
+private:
+    HttpRequester() = default;
+    ~HttpRequester();
+
+    HttpRequester(const HttpRequester &) = delete;
+    HttpRequester &operator=(const HttpRequester &) = delete;
+
+    struct Request {
+        size_t id = SIZE_MAX;
+        std::string url;
+        CompletionListener listener;
+    };
+
+    void requestLoop();
+
+    /**
+     * Runs `curl` for a request and waits for it to exit.
+     *
+     * @return The exit code of `curl`, or -1 if it could not run or was killed.
+     */
+    int send(const std::string &url);
+
+    std::mutex mutex;
+    std::condition_variable requestCondition;
+    std::deque<Request> requests; ///< Requests waiting to be sent, guarded by mutex.
+    Request current;              ///< The request being sent; no listener once cancelled.
+    pid_t currentPid = -1;        ///< The `curl` process of the current request, or -1.
+    size_t nextRequestId = 0;
+    bool stopping = false;
+    std::thread requestThread;
+};
+
+#endif // OTTO_HTTPREQUESTER_H
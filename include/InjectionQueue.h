@@ -0,0 +1,125 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_INJECTIONQUEUE_H
+#define OTTO_INJECTIONQUEUE_H
+
+#include "MpscRing.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A single key transition to send.
+ */
+struct KeyEvent {
+    int keyType; ///< Press, release or repeat (KET_*).
+    int keyCode; ///< The key code to send.
+};
+
+/**
+ * Key events that are sent together as one synchronized report.
+ */
+struct InjectionReport {
+    static constexpr size_t MaxEvents = 8;
+
+    uint16_t outputDevice = 0; ///< Index of the output device to send to.
+    uint32_t count = 0;
+    KeyEvent events[MaxEvents];
+    int64_t captureUs = -1; ///< Monotonic capture time of mirrored events, for latency tracking; -1 if none.
+};
+
+/**
+ * InjectionQueue carries reports from any number of producer threads to a single injector
+ * thread without locks.
+ *
+ * Reports are queued on lanes, multi-producer/single-consumer rings, by the output device
+ * they go to; devices share a lane only beyond LaneCount. Reports to one device are delivered
+ * in the order they were pushed, whichever threads push them, so a script keeps its order
+ * while its task moves between worker threads. The consumer drains the lanes round-robin, one
+ * report per lane per pass, so a busy device cannot starve the others. A sleeping consumer is
+ * woken through an eventfd, which producers only touch while it sleeps.
+ */
+class InjectionQueue {
+public:
+    static constexpr size_t LaneCount = 16; ///< Output devices that get a lane of their own.
+    static constexpr size_t LaneCapacity = 128;
+
+    InjectionQueue();
+    ~InjectionQueue();
+
+    InjectionQueue(const InjectionQueue &) = delete;
+    InjectionQueue &operator=(const InjectionQueue &) = delete;
+
+    /**
+     * Queues a report on the lane of its output device. Waits for room rather than dropping it
+     * if the lane is full. Thread safe.
+     *
+     * @param report The report to queue.
+     */
+    void push(const InjectionReport &report);
+
+    /**
+     * Delivers queued reports, round-robin across lanes, until all lanes are empty.
+     * Must only be called from the consumer thread.
+     *
+     * @param deliver Called with each report.
+     * @return The number of reports delivered.
+     */
+    template <typename Deliver> size_t drain(Deliver &&deliver) {
+        size_t delivered = 0;
+        bool progress = true;
+        InjectionReport report;
+        while (progress) {
+            progress = false;
+            for (auto &lane : lanes) {
+                if (lane.tryPop(report)) {
+                    deliver(report);
+                    ++delivered;
+                    progress = true;
+                }
+            }
+        }
+        return delivered;
+    }
+
+    /**
+     * Sleeps until a report is pushed, wake() is called or the timeout expires.
+     * Must only be called from the consumer thread.
+     *
+     * @param timeoutMs The longest time to sleep.
+     */
+    void wait(int timeoutMs);
+
+    /**
+     * Wakes the consumer, e.g. to let it notice a shutdown request.
+     */
+    void wake();
+
+private:
+    bool isEmpty() const;
+
+    std::array<MpscRing<InjectionReport, LaneCapacity>, LaneCount> lanes;
+    std::atomic<bool> consumerSleeping{false};
+    int wakeFd = -1;
+};
+
+#endif // OTTO_INJECTIONQUEUE_H
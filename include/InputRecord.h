@@ -0,0 +1,121 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_INPUTRECORD_H
+#define OTTO_INPUTRECORD_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Event types and values stored in an InputRecord. They follow the evdev convention so raw
+ * records can be passed to uinput unchanged; IR key events are normalized to it on capture.
+ * Raw captures hold every evdev event type (EV_SYN, EV_REL, EV_ABS, ...), not only keys.
+ */
+enum InputRecordType : uint16_t {
+    INPUT_TYPE_SYN = 0x00,              ///< Same value as EV_SYN.
+    INPUT_TYPE_KEY = 0x01,              ///< Same value as EV_KEY.
+    INPUT_TYPE_DEVICE = 0xFF00,         ///< Metadata: describes a capture device, followed by its name as payload.
+    INPUT_TYPE_CAPABILITIES = 0xFF01    ///< Metadata: a CaptureDeviceCapabilities payload for a device.
+};
+
+enum InputRecordValue : int32_t { INPUT_RELEASE = 0, INPUT_PRESS = 1, INPUT_REPEAT = 2 };
+
+/**
+ * A captured input event. This is both the unit handed from the capture thread to the writer
+ * thread and the fixed-size record of the binary capture format.
+ *
+ * Records whose type is INPUT_TYPE_DEVICE or above are metadata: their value holds a payload
+ * length in bytes, and the payload occupies the following records, padded to a whole record.
+ */
+struct InputRecord {
+    int64_t timestampUs; ///< Event time in microseconds; only differences between records are meaningful.
+    uint16_t deviceId;   ///< Capture device the event came from.
+    uint16_t type;       ///< Event type, e.g. INPUT_TYPE_KEY.
+    uint16_t code;       ///< Platform key code.
+    uint16_t reserved;
+    int32_t value;       ///< INPUT_PRESS, INPUT_RELEASE or INPUT_REPEAT for key events.
+    uint32_t padding;
+};
+
+static_assert(sizeof(InputRecord) == 24, "InputRecord is part of the binary capture format");
+
+/**
+ * Absolute axis parameters, as in struct input_absinfo.
+ */
+struct CaptureAbsInfo {
+    int32_t minimum;
+    int32_t maximum;
+    int32_t fuzz;
+    int32_t flat;
+    int32_t resolution;
+};
+
+/**
+ * What a capture device can report, written with raw captures so a replay can create a
+ * virtual device that reports the same events. Bit arrays are laid out like the kernel's
+ * EVIOCGBIT results.
+ */
+struct CaptureDeviceCapabilities {
+    static constexpr size_t KeyCount = 0x300; ///< KEY_CNT
+    static constexpr size_t RelCount = 0x10;  ///< REL_CNT
+    static constexpr size_t AbsCount = 0x40;  ///< ABS_CNT
+    static constexpr size_t MscCount = 0x08;  ///< MSC_CNT
+    static constexpr size_t PropCount = 0x20; ///< INPUT_PROP_CNT
+
+    uint16_t bustype;
+    uint16_t vendor;
+    uint16_t product;
+    uint16_t version;
+    uint32_t eventTypes; ///< Bit n set if the device reports event type n.
+    uint8_t keyBits[KeyCount / 8];
+    uint8_t relBits[RelCount / 8];
+    uint8_t absBits[AbsCount / 8];
+    uint8_t mscBits[MscCount / 8];
+    uint8_t propBits[PropCount / 8];
+    uint8_t reserved[1];
+    CaptureAbsInfo absInfo[AbsCount]; ///< Parameters of each axis set in absBits.
+};
+
+static_assert(sizeof(CaptureDeviceCapabilities) == 1404,
+              "CaptureDeviceCapabilities is part of the binary capture format");
+
+/**
+ * Header at the start of a binary capture file.
+ */
+struct CaptureFileHeader {
+    char magic[8];       ///< CaptureMagic, including the terminating NUL.
+    uint32_t version;    ///< CaptureVersion.
+    uint32_t recordSize; ///< sizeof(InputRecord) at the time of writing.
+};
+
+constexpr char CaptureMagic[8] = "OTTOREC";
+constexpr uint32_t CaptureVersion = 1;
+
+/**
+ * Returns the number of records occupied by a metadata record's payload.
+ */
+inline uint32_t payloadRecords(const InputRecord &record) {
+    if (record.type < INPUT_TYPE_DEVICE || record.value <= 0) {
+        return 0;
+    }
+    return (static_cast<uint32_t>(record.value) + sizeof(InputRecord) - 1) / sizeof(InputRecord);
+}
+
+#endif // OTTO_INPUTRECORD_H
@@ -20,9 +20,13 @@
 #ifndef OTTO_KEYMANAGER_H
 #define OTTO_KEYMANAGER_H
 
+#include "EventManager.h"
 #include "KeyMap.h"
+#include "Timeline.h"
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
@@ -32,18 +36,22 @@ class KeyManager {
 public:
     /**
      * Constructs a KeyManager with a default KeyMap.
+     *
+     * @param intervalMs Time between the press and release of a key press.
+     * @param outputDevice Index of the output device that key events are sent to.
      */
-    KeyManager(int intervalMs = 50);
+    KeyManager(int intervalMs = 50, size_t outputDevice = 0);
 
     ~KeyManager();
 
     /**
-     * Sends a key press event with optional repeat count and interval.
+     * Schedules a key press event with optional repeat count and interval.
      *
+     * @param timeline The timeline to schedule the events on.
      * @param key The key name (e.g., "power", "volup").
      * @param repeat The number of times to repeat the key press (default: 1).
      */
-    void sendKeyPress(const std::string &key, int repeat = 1);
+    void sendKeyPress(Timeline &timeline, const std::string &key, int repeat = 1);
 
     /**
      * Sends a key release event.
@@ -53,28 +61,159 @@ public:
     void sendKeyRelease(const std::string &key);
 
     /**
-     * Sends a key hold event for a specified duration.
+     * Schedules a key hold event for a specified duration, optionally with autorepeat.
+     *
+     * Repeats are sent like the kernel's autorepeat: the first one after repeatDelayMs, then one
+     * every repeatPeriodMs until the key is released. They are paced on absolute deadlines, so
+     * their rate does not drift with the time spent sending them.
      *
+     * @param timeline The timeline to schedule the events on.
      * @param key The key name (e.g., "power", "volup").
      * @param durationMs The duration to hold the key in milliseconds.
+     * @param repeatDelayMs Delay before the first repeat, or -1 to send no repeats.
+     * @param repeatPeriodMs Time between repeats; must be positive when repeating.
+     */
+    void sendKeyHold(Timeline &timeline, const std::string &key, int durationMs, int repeatDelayMs = -1,
+                     int repeatPeriodMs = 0);
+
+    /**
+     * Presses keys down in a single report and leaves them held until sendKeyUp().
+     *
+     * @param timeline The timeline to schedule the report on.
+     * @param keys The key names to press together.
+     */
+    void sendKeyDown(Timeline &timeline, const std::vector<std::string> &keys);
+
+    /**
+     * Releases keys in a single report.
+     *
+     * @param timeline The timeline to schedule the report on.
+     * @param keys The key names to release together.
+     */
+    void sendKeyUp(Timeline &timeline, const std::vector<std::string> &keys);
+
+    /**
+     * Schedules the release of every key still held by sendKeyDown(), e.g. when a script ends.
+     *
+     * @param timeline The timeline to schedule on.
+     * @return True if any keys were held.
+     */
+    bool releaseHeldKeys(Timeline &timeline);
+
+    /**
+     * @return The keys held down by sendKeyDown() and not yet released, in the order pressed.
+     */
+    const std::vector<int> &getHeldKeys() const;
+
+    /**
+     * Presses keys again that were held when a script was interrupted, e.g. when resuming it.
+     *
+     * @param timeline The timeline to schedule on.
+     * @param keyCodes The key codes, in the order they were pressed.
      */
-    void sendKeyHold(const std::string &key, int durationMs);
+    void pressHeldKeys(Timeline &timeline, const std::vector<int> &keyCodes);
+
+    /**
+     * Presses keys simultaneously and releases them together, e.g. for platform shortcuts.
+     *
+     * @param timeline The timeline to schedule the reports on.
+     * @param keys The key names, pressed in order in one report and released in reverse order in another.
+     * @param holdMs How long to hold the keys, or -1 for the key press interval.
+     */
+    void sendKeyCombo(Timeline &timeline, const std::vector<std::string> &keys, int holdMs = -1);
+
+    /**
+     * Types a string. Characters are mapped to keys through the key map, with shift for
+     * capitals and symbols, and the whole sequence is scheduled at once.
+     *
+     * @param timeline The timeline to schedule the events on.
+     * @param text The text to type.
+     * @param charIntervalMs Time between characters, or -1 for the key press interval.
+     */
+    void typeText(Timeline &timeline, const std::string &text, int charIntervalMs = -1);
 
     /**
      * Starts recording key events.
      *
      * @param outputFile The file to save the recorded events.
+     * @param options Capture options for the session.
      */
-    void startRecording(const std::string &outputFile);
+    void startRecording(const std::string &outputFile, const RecordOptions &options = RecordOptions());
 
     /**
      * Stops the ongoing recording and saves the events to the file.
      */
     void stopRecording();
 
+    /**
+     * Replays a binary capture file, reproducing the recorded timing. Devices of a raw capture
+     * are recreated as virtual devices with the captured capabilities, and their events are
+     * replayed frame by frame.
+     *
+     * @param captureFile The binary capture file to replay.
+     * @param speed Replay speed factor; 2.0 replays twice as fast.
+     */
+    void replayCapture(const std::string &captureFile, double speed = 1.0);
+
+    /**
+     * Converts a binary capture file into a commands file.
+     *
+     * @param captureFile The binary capture file to read.
+     * @param outputFile The commands file to write.
+     */
+    void convertCapture(const std::string &captureFile, const std::string &outputFile);
+
 private:
+    static constexpr int DeviceSettleMs = 200; ///< Time for readers to open new virtual devices before a replay.
+
     int intervalMs;
+    size_t outputDevice;
+    bool isRecording = false;
     KeyMap keyMap;
+    std::vector<int> heldKeys; ///< Keys pressed by sendKeyDown() and not yet released.
+
+    /**
+     * A key typed for one character of text.
+     */
+    struct TextKey {
+        int keyCode;
+        bool shift;
+    };
+
+    std::unordered_map<std::string, std::vector<TextKey>> textSequences; ///< Key sequences by text, built once.
+    int shiftKeyCode = -1;
+
+    /**
+     * Maps text to the keys that type it.
+     *
+     * @return False if some character has no key.
+     */
+    bool buildTextSequence(const std::string &text, std::vector<TextKey> &sequence);
+
+    /**
+     * Finds the key that types a character.
+     *
+     * @return The key code, or -1 if no key types the character.
+     */
+    int findTextKey(char c, bool &shift) const;
+
+    /**
+     * Resolves key names to key codes.
+     *
+     * @return False if any key name is unknown.
+     */
+    bool resolveKeys(const std::vector<std::string> &keys, std::vector<int> &keyCodes) const;
+
+    /**
+     * Sends one key event per key code as a single report.
+     */
+    void sendEvents(int keyType, const std::vector<int> &keyCodes);
+
+    /**
+     * Schedules one key event per key code as a single report.
+     */
+    void scheduleEvents(Timeline &timeline, Timeline::Clock::time_point due, int keyType,
+                        const std::vector<int> &keyCodes);
 
     /**
      * Sends a key event to IRMGR via uinput dispatcher.
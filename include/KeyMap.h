@@ -92,10 +92,10 @@ enum KeyCodes {
     KEY_RECORD = 0x0000009CUL,
     KEY_EXIT = 0x00000087UL,
     KEY_INFO = 0x0000008EUL,
-    KEY_KEYA = 0x00000092UL,
-    KEY_KEYB = 0x00000093UL,
-    KEY_KEYC = 0x00000094UL,
-    KEY_KEYD = 0x0000009FUL,
+    KEY_A = 0x00000092UL,
+    KEY_B = 0x00000093UL,
+    KEY_C = 0x00000094UL,
+    KEY_D = 0x0000009FUL,
     KEY_INPUTKEY = 0x000000D0UL,
     KEY_HELP = 0x000000A1UL
 };
@@ -103,13 +103,19 @@ enum KeyCodes {
 
 /**
  * The KeyMap class manages the mapping of command strings to key codes.
+ *
+ * The default mappings live in a single compile-time table shared by every KeyMap, so
+ * constructing a KeyMap is free and lookups in either direction are constant time.
+ *
+ * Names are resolved from, in order: mappings added with addMapping(), the loaded key map
+ * profile, the defaults, and (with uinput) the full set of Linux key names such as KEY_MUTE.
  */
 class KeyMap {
 public:
     /**
      * Initializes the key map with default mappings.
      */
-    KeyMap();
+    KeyMap() = default;
 
     /**
      * Gets the key code corresponding to a given command.
@@ -119,6 +125,14 @@ public:
      */
     int getKeyCode(const std::string &command) const;
 
+    /**
+     * Looks up the key code for a command like getKeyCode(), without logging a miss.
+     *
+     * @param command The command string.
+     * @return The corresponding key code, or -1 if the command is not found.
+     */
+    int findKeyCode(const std::string &command) const;
+
     /**
      * Gets the command string corresponding to a given key code.
      *
@@ -128,16 +142,24 @@ public:
     std::string getKeyName(int keyCode) const;
 
     /**
-     * Adds or updates a command-keyCode mapping.
+     * Adds or updates a command-keyCode mapping. Added mappings take precedence over the defaults.
      *
      * @param command The command string.
      * @param keyCode The key code to associate with the command.
      */
     void addMapping(const std::string &command, int keyCode);
 
+    /**
+     * Loads a key map profile shared by all key maps. Call it before any key map is in use.
+     *
+     * @param filePath The profile file; see KeyProfile for its format.
+     * @throws std::runtime_error If the profile cannot be loaded.
+     */
+    static void loadProfile(const std::string &filePath);
+
 private:
-    std::unordered_map<std::string, int> keyMappings;
-    void loadDefaultMappings();
+    std::unordered_map<std::string, int> customMappings;
+    std::unordered_map<int, std::string> customNames;
 };
 
 #endif // OTTO_KEYMAP_H
@@ -22,12 +22,15 @@
 
 #include "BaseExecutor.h"
 #include "KeyManager.h"
+#include "Timeline.h"
 
 #include <string>
 #include <vector>
 
 /**
- * KeyPressExecutor handles "key_press" commands to send key events.
+ * KeyPressExecutor handles "key_press" and "key_hold" commands to send key events, and the
+ * "key_down", "key_up" and "key_combo" commands that press several keys in one report, and
+ * "type_text" for entering text.
  */
 class KeyPressExecutor : public BaseExecutor {
 public:
@@ -35,18 +38,28 @@ public:
      * Constructs a KeyPressExecutor with a reference to the KeyManager.
      *
      * @param keyManager The KeyManager instance for sending key events.
+     * @param timeline The script's timeline, used to scale hold durations.
      */
-    KeyPressExecutor(KeyManager &keyManager);
+    KeyPressExecutor(KeyManager &keyManager, Timeline &timeline);
 
     /**
-     * Executes the "key_press" command.
+     * Executes a key command.
      *
-     * @param args The arguments for the command (e.g., ["key_press", "power", "3"]).
+     * @param args The arguments for the command (e.g., ["key_press", "power", "3"], ["key_hold", "ok", "2s"]
+     *             or ["key_combo", "home", "0", "1s"]).
      */
     void execute(const std::vector<std::string> &args) override;
 
 private:
+    static constexpr int DefaultRepeatDelayMs = 250; ///< The kernel's default autorepeat delay.
+    static constexpr int DefaultRepeatPeriodMs = 33; ///< The kernel's default autorepeat period.
+
+    void executeKeyHold(const std::vector<std::string> &args);
+    void executeKeyChord(const std::vector<std::string> &args);
+    void executeTypeText(const std::vector<std::string> &args);
+
     KeyManager &keyManager;
+    Timeline &timeline;
 };
 
 #endif // OTTO_KEYPRESSEXECUTOR_H
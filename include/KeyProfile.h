@@ -0,0 +1,101 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_KEYPROFILE_H
+#define OTTO_KEYPROFILE_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * KeyProfile is a key map loaded from a profile file, e.g. for a specific remote model or platform.
+ *
+ * A profile is a text file with one "<name> <code>" mapping per line, where code is a number
+ * or an existing key name, and lines starting with '#' are comments:
+ *
+ *     # XR15 remote
+ *     ok       KEY_ENTER
+ *     netflix  0x1a2
+ *
+ * The parsed table uses the same perfect-hash layout as the built-in KeyTable. It is cached
+ * next to the profile as "<profile>.cache" and reloaded from there, without parsing or
+ * hashing, for as long as the profile is unchanged.
+ */
+class KeyProfile {
+public:
+    static constexpr size_t MaxNameLength = 31;
+
+    /**
+     * Loads a profile, from its cache if it is up to date.
+     *
+     * @param filePath The profile file.
+     * @param resolveName Resolves key names used as codes in the profile; returns -1 if unknown.
+     * @throws std::runtime_error If the profile cannot be read or is invalid.
+     */
+    KeyProfile(const std::string &filePath, const std::function<int(const std::string &)> &resolveName);
+
+    /**
+     * Looks up the code for a name.
+     *
+     * @return The key code, or -1 if the name is not in the profile.
+     */
+    int findCode(std::string_view name) const;
+
+    /**
+     * Looks up the name for a code.
+     *
+     * @return The first name listed for the code, or an empty view if there is none.
+     */
+    std::string_view findName(int code) const;
+
+    size_t size() const;
+
+private:
+    struct Entry {
+        char name[MaxNameLength + 1];
+        int32_t code;
+    };
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t entryCount;
+        int64_t sourceMtimeNs;
+        int64_t sourceSize;
+        uint32_t bucketCount;
+        uint32_t slotCount;
+        uint32_t codeLimit;
+        uint32_t reserved;
+    };
+
+    void parse(const std::string &filePath, const std::function<int(const std::string &)> &resolveName);
+    void build();
+    bool readCache(const std::string &cachePath, int64_t mtimeNs, int64_t size);
+    void writeCache(const std::string &cachePath, int64_t mtimeNs, int64_t size) const;
+
+    std::vector<Entry> entries;
+    std::vector<uint16_t> seeds;
+    std::vector<int16_t> slots;
+    std::vector<int16_t> byCode;
+};
+
+#endif // OTTO_KEYPROFILE_H
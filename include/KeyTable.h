@@ -0,0 +1,231 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_KEYTABLE_H
+#define OTTO_KEYTABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * A key name and the key code it maps to.
+ */
+struct KeyEntry {
+    std::string_view name;
+    int code;
+};
+
+/**
+ * Seeded FNV-1a hash of a key name, usable in constant expressions.
+ */
+constexpr uint32_t hashKeyName(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+/**
+ * Returns the largest key code in a list of entries.
+ */
+template <size_t N> constexpr int maxKeyCode(const KeyEntry (&entries)[N]) {
+    int maxCode = 0;
+    for (const auto &entry : entries) {
+        maxCode = entry.code > maxCode ? entry.code : maxCode;
+    }
+    return maxCode;
+}
+
+constexpr int16_t KeySlotEmpty = -1;
+
+/**
+ * Places key names into slots with a hash-and-displace perfect hash: each name hashes to a
+ * bucket, and each bucket gets a displacement seed that sends all of its names to free slots.
+ * The fullest buckets are placed first, while slots are still plentiful.
+ *
+ * Works on std::array at compile time and on std::vector at run time.
+ *
+ * @param nameAt Callable returning the name of entry i.
+ * @param count Number of entries.
+ * @param bucketOf Scratch space for count bucket indices.
+ * @param bucketSize Scratch space for one counter per bucket, zero-initialized.
+ * @param seeds Receives one seed per bucket; its size is the bucket count.
+ * @param slots Receives the entry index per slot, pre-filled with KeySlotEmpty; its size must be a power of two.
+ * @return False if some bucket could not be placed, e.g. because a name is listed twice.
+ */
+template <typename NameAt, typename BucketOf, typename BucketSize, typename Seeds, typename Slots>
+constexpr bool buildKeyHash(NameAt nameAt, size_t count, BucketOf &bucketOf, BucketSize &bucketSize, Seeds &seeds,
+                            Slots &slots) {
+    const size_t bucketCount = seeds.size();
+    const size_t slotMask = slots.size() - 1;
+
+    for (size_t i = 0; i < count; ++i) {
+        bucketOf[i] = hashKeyName(nameAt(i), 0) % bucketCount;
+        ++bucketSize[bucketOf[i]];
+    }
+
+    for (size_t round = 0; round < bucketCount; ++round) {
+        size_t bucket = 0;
+        size_t largest = 0;
+        for (size_t b = 0; b < bucketCount; ++b) {
+            if (bucketSize[b] > largest) {
+                bucket = b;
+                largest = bucketSize[b];
+            }
+        }
+        if (largest == 0) {
+            break;
+        }
+        bucketSize[bucket] = 0;
+
+        bool placed = false;
+        for (uint32_t seed = 1; !placed && seed < UINT16_MAX; ++seed) {
+            placed = true;
+            size_t i = 0;
+            for (; i < count; ++i) {
+                if (bucketOf[i] != bucket) {
+                    continue;
+                }
+                size_t slot = hashKeyName(nameAt(i), seed) & slotMask;
+                if (slots[slot] != KeySlotEmpty) {
+                    placed = false;
+                    break;
+                }
+                slots[slot] = static_cast<int16_t>(i);
+            }
+
+            if (placed) {
+                seeds[bucket] = static_cast<uint16_t>(seed);
+                continue;
+            }
+
+            // Undo this attempt's placements before trying the next seed.
+            for (size_t k = 0; k < i; ++k) {
+                size_t slot = hashKeyName(nameAt(k), seed) & slotMask;
+                if (bucketOf[k] == bucket && slots[slot] == static_cast<int16_t>(k)) {
+                    slots[slot] = KeySlotEmpty;
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns the slot a name would occupy in a table built by buildKeyHash().
+ */
+template <typename Seeds> constexpr size_t findKeySlot(std::string_view name, const Seeds &seeds, size_t slotCount) {
+    size_t bucket = hashKeyName(name, 0) % seeds.size();
+    return hashKeyName(name, seeds[bucket]) & (slotCount - 1);
+}
+
+/**
+ * Returns the smallest power of two not less than n.
+ */
+constexpr size_t nextPowerOfTwo(size_t n) {
+    size_t power = 1;
+    while (power < n) {
+        power <<= 1;
+    }
+    return power;
+}
+
+/**
+ * KeyTable is an immutable bidirectional key table built at compile time.
+ *
+ * Names are looked up through a perfect hash (see buildKeyHash()), so a lookup is two hashes
+ * and one comparison. Codes are looked up in a dense array indexed by code. When several
+ * names share a code, the first one listed is returned by findName().
+ *
+ * @tparam N Number of entries.
+ * @tparam CodeLimit One more than the largest key code.
+ */
+template <size_t N, size_t CodeLimit> class KeyTable {
+    static constexpr size_t SlotCount = nextPowerOfTwo(2 * N);
+    static constexpr size_t BucketCount = N / 2 + 1;
+
+    static_assert(N > 0 && N < 32768, "KeyTable size out of range");
+
+public:
+    /**
+     * Builds the table. Fails to compile if a name is listed twice.
+     *
+     * @param source The key entries.
+     */
+    constexpr explicit KeyTable(const KeyEntry (&source)[N]) {
+        for (size_t i = 0; i < N; ++i) {
+            entries[i] = source[i];
+        }
+        for (auto &slot : slots) {
+            slot = KeySlotEmpty;
+        }
+        for (auto &index : byCode) {
+            index = KeySlotEmpty;
+        }
+
+        std::array<size_t, N> bucketOf{};
+        std::array<size_t, BucketCount> bucketSize{};
+        if (!buildKeyHash([this](size_t i) { return entries[i].name; }, N, bucketOf, bucketSize, seeds, slots)) {
+            throw "KeyTable: no displacement found; duplicate key name?";
+        }
+
+        for (size_t i = 0; i < N; ++i) {
+            int code = entries[i].code;
+            if (code >= 0 && static_cast<size_t>(code) < CodeLimit && byCode[code] == KeySlotEmpty) {
+                byCode[code] = static_cast<int16_t>(i);
+            }
+        }
+    }
+
+    /**
+     * Looks up the code for a name.
+     *
+     * @return The key code, or -1 if the name is not in the table.
+     */
+    constexpr int findCode(std::string_view name) const {
+        int16_t index = slots[findKeySlot(name, seeds, SlotCount)];
+        return (index != KeySlotEmpty && entries[index].name == name) ? entries[index].code : -1;
+    }
+
+    /**
+     * Looks up the name for a code.
+     *
+     * @return The first name listed for the code, or an empty view if there is none.
+     */
+    constexpr std::string_view findName(int code) const {
+        if (code < 0 || static_cast<size_t>(code) >= CodeLimit || byCode[code] == KeySlotEmpty) {
+            return {};
+        }
+        return entries[byCode[code]].name;
+    }
+
+private:
+    std::array<KeyEntry, N> entries{};
+    std::array<uint16_t, BucketCount> seeds{};
+    std::array<int16_t, SlotCount> slots{};
+    std::array<int16_t, CodeLimit> byCode{};
+};
+
+#endif // OTTO_KEYTABLE_H
@@ -0,0 +1,67 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_LATENCYHISTOGRAM_H
+#define OTTO_LATENCYHISTOGRAM_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/**
+ * LatencyHistogram collects latency samples in fixed-width buckets, so recording a sample is
+ * constant time and allocation free, and reports their distribution.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int64_t BucketUs = 50;     ///< Width of a bucket.
+    static constexpr size_t BucketCount = 1000; ///< Samples of 50ms or more share the last bucket.
+
+    /**
+     * Adds a sample.
+     *
+     * @param latencyUs The latency in microseconds; negative values count as zero.
+     */
+    void add(int64_t latencyUs);
+
+    void reset();
+
+    uint64_t count() const;
+
+    /**
+     * Returns the latency below which a given fraction of the samples fall.
+     *
+     * @param fraction The fraction, e.g. 0.99 for the 99th percentile.
+     * @return The upper bound of the bucket holding that sample, in microseconds.
+     */
+    int64_t percentile(double fraction) const;
+
+    /**
+     * Formats the count, mean, median, 99th percentile and maximum, e.g. for a log line.
+     */
+    std::string summary() const;
+
+private:
+    std::array<uint64_t, BucketCount> buckets{};
+    uint64_t samples = 0;
+    int64_t totalUs = 0;
+    int64_t maxUs = 0;
+};
+
+#endif // OTTO_LATENCYHISTOGRAM_H
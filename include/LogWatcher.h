@@ -0,0 +1,128 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_LOGWATCHER_H
+#define OTTO_LOGWATCHER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+
+/**
+ * LogWatcher tails log files for lines matching a pattern. All watches share one thread that
+ * sleeps on inotify, so nothing polls the files. Each watched file's directory is watched too,
+ * so a file that is rotated (moved or deleted and recreated) or truncated keeps being followed.
+ */
+class LogWatcher {
+public:
+    static LogWatcher &getInstance();
+
+    /**
+     * Called on the watcher thread with the first line that matches, or with matched false and
+     * the reason if the watcher thread failed before one did; must return quickly.
+     */
+    using MatchListener = std::function<void(bool matched, const std::string &line)>;
+
+    /**
+     * Starts tailing a file from its current end; only lines written afterwards are matched.
+     * A file that does not exist yet is read from its start once it is created. The listener
+     * is called at most once. Starts the watcher thread again if it has failed. Thread safe.
+     *
+     * @param path The log file.
+     * @param pattern The pattern searched for in each line.
+     * @param listener Called with the first matching line.
+     * @return An id to remove the watch with.
+     * @throws std::runtime_error if inotify is unavailable or the directory cannot be watched.
+     */
+    size_t addWatch(const std::string &path, std::shared_ptr<const std::regex> pattern, MatchListener listener);
+
+    /**
+     * Removes a watch. Once this returns its listener is not running and is not called again.
+     * Thread safe.
+     *
+     * @param watchId The id returned by addWatch().
+     */
+    void removeWatch(size_t watchId);
+
+private:
+    static constexpr size_t ReadChunkSize = 16 * 1024;
+    static constexpr size_t MaxLineLength = 4096; ///< Longer lines are matched by their start only.
+
+    LogWatcher();
+    ~LogWatcher();
+
+    LogWatcher(const LogWatcher &) = delete;
+    LogWatcher &operator=(const LogWatcher &) = delete;
+
+    struct Watch {
+        std::string path;
+        std::string fileName;
+        int directoryWd = -1; ///< The inotify watch on the file's directory.
+        std::shared_ptr<const std::regex> pattern;
+        MatchListener listener;
+        int fd = -1;       ///< The file being tailed, or -1 until it exists.
+        ino_t inode = 0;   ///< Identifies the open file, to notice when the path is replaced.
+        off_t offset = 0;  ///< Bytes of the open file consumed so far.
+        std::string partialLine;
+        bool skippingLine = false; ///< The rest of an overlong line is being dropped.
+        bool matched = false;
+    };
+
+    void watchLoop();
+
+    /**
+     * Ends every watch that has not matched yet, telling its listener why.
+     * Must be called with watchMutex held.
+     */
+    void failWatches(const std::string &reason);
+    void handleEvents();
+
+    /**
+     * Consumes what was appended to a watch's file, following rotation and truncation.
+     * Must be called with watchMutex held.
+     */
+    void readWatch(Watch &watch);
+
+    /**
+     * Reads from the current offset to the end of the open file and matches complete lines.
+     *
+     * @return False if the file has shrunk below the offset, i.e. it was truncated.
+     */
+    bool readAppended(Watch &watch);
+
+    static bool openFile(Watch &watch, bool fromEnd);
+    static void closeFile(Watch &watch);
+
+    int inotifyFd = -1;
+    int wakeFd = -1;
+    std::atomic<bool> isRunning{false};
+    std::thread watchThread;
+    std::mutex watchMutex;
+    std::map<size_t, Watch> watches;                   ///< Guarded by watchMutex.
+    std::map<int, size_t> directoryRefs; ///< Watches per directory wd, guarded by watchMutex.
+    size_t nextWatchId = 0;
+};
+
+#endif // OTTO_LOGWATCHER_H
@@ -56,6 +56,25 @@ void setLogLevel(LogLevel level);
  */
 LogLevel stringToLogLevel(const std::string &levelStr);
 
+/**
+ * Sets a context shown with every message logged by the calling thread, e.g. the script it runs.
+ *
+ * @param context The context; empty to show none.
+ * @param minLevel The lowest level the thread logs while in the context, on top of the global
+ *                 level; e.g. to quieten a simulated run without affecting other threads.
+ */
+void setLogContext(const std::string &context, LogLevel minLevel = LogLevel::TRACE);
+
+/**
+ * @return The calling thread's log context, as passed to setLogContext.
+ */
+const std::string &getLogContext();
+
+/**
+ * @return The lowest level the calling thread logs in its context, as passed to setLogContext.
+ */
+LogLevel getLogContextLevel();
+
 /**
  * Logs a message at a specified logging level.
  * 
@@ -64,6 +83,12 @@ LogLevel stringToLogLevel(const std::string &levelStr);
  */
 void logMessage(LogLevel level, const std::string &message);
 
+/**
+ * Checks whether messages at a level are logged by the calling thread, so hot paths can skip
+ * building them.
+ */
+bool isLogEnabled(LogLevel level);
+
 /**
  * Convenience functions for logging at specific levels.
  */
@@ -26,6 +26,7 @@
 #include <memory>
 #include <stack>
 #include <utility>
+#include <vector>
 
 /**
  * The `LoopExecutor` manages the execution of loops in the command sequence.
@@ -39,6 +40,20 @@ public:
      */
     void execute(const std::vector<std::string> &args) override;
 
+    /**
+     * Retrieves the open loops, e.g. for a checkpoint.
+     *
+     * @return The start index and remaining iterations of each open loop, outermost first.
+     */
+    std::vector<std::pair<int, int>> getLoops() const;
+
+    /**
+     * Replaces the open loops, e.g. when resuming from a checkpoint.
+     *
+     * @param loops The start index and remaining iterations of each loop, outermost first.
+     */
+    void setLoops(const std::vector<std::pair<int, int>> &loops);
+
 private:
     std::shared_ptr<CommandExecutor> executor; ///< Shared pointer to the CommandExecutor for delegating commands.
     std::stack<std::pair<int, int>> loopStack; ///< Stack to manage nested loops.
@@ -0,0 +1,115 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_MPSCRING_H
+#define OTTO_MPSCRING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Bounded multi-producer/single-consumer lock-free ring buffer.
+ *
+ * Any number of threads may call tryPush(); exactly one thread may call tryPop(). Each slot
+ * carries a sequence number that tells whose turn it is: a producer reserves a slot with a
+ * single compare-and-swap on the tail and then publishes it by advancing the sequence, so
+ * producers never wait for one another. Elements are popped in the order their slots were
+ * reserved, so pushes ordered by happens-before, e.g. one after the other on any threads,
+ * are popped in that order. Capacity must be a power of two.
+ */
+template <typename T, size_t Capacity> class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "MpscRing capacity must be a power of two");
+
+public:
+    MpscRing() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    /**
+     * Appends an element to the ring. Thread safe.
+     *
+     * @param item The element to append.
+     * @return True if the element was queued, false if the ring is full.
+     */
+    bool tryPush(const T &item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[tail & (Capacity - 1)];
+            auto lag = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire) - tail);
+            if (lag == 0) {
+                if (tailIndex.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.sequence.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                // The slot still holds the element pushed one lap earlier.
+                return false;
+            } else {
+                tail = tailIndex.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Removes the oldest element from the ring. Must only be called from the consumer thread.
+     *
+     * @param item Receives the removed element.
+     * @return True if an element was removed, false if the ring is empty or the oldest element
+     *         is still being written.
+     */
+    bool tryPop(T &item) {
+        Slot &slot = slots[headIndex & (Capacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != headIndex + 1) {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(headIndex + Capacity, std::memory_order_release);
+        ++headIndex;
+        return true;
+    }
+
+    /**
+     * Checks whether an element is ready to pop. Must only be called from the consumer thread.
+     */
+    bool empty() const {
+        return slots[headIndex & (Capacity - 1)].sequence.load(std::memory_order_acquire) != headIndex + 1;
+    }
+
+private:
+    static constexpr size_t CacheLine = 64;
+
+    struct Slot {
+        std::atomic<size_t> sequence{0}; ///< Index + 1 once written, index + Capacity once read.
+        T item{};
+    };
+
+    alignas(CacheLine) size_t headIndex = 0;             ///< Next slot to read, owned by the consumer.
+    alignas(CacheLine) std::atomic<size_t> tailIndex{0}; ///< Next slot to reserve, shared by producers.
+    alignas(CacheLine) std::array<Slot, Capacity> slots;
+};
+
+#endif // OTTO_MPSCRING_H
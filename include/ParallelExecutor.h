@@ -0,0 +1,87 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_PARALLEL_EXECUTOR_H
+#define OTTO_PARALLEL_EXECUTOR_H
+
+#include "BaseExecutor.h"
+#include "CommandExecutor.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * The `ParallelExecutor` runs fork-join blocks:
+ *
+ *     parallel_start
+ *     branch
+ *     key_hold down 3s
+ *     branch
+ *     launch_app YouTube
+ *     parallel_end
+ *
+ * The branches are handed to the script, which runs each of them concurrently with its own
+ * command executors and a copy of the variables and of the timeline, so branches never share
+ * script state. Execution continues after parallel_end once every branch has finished;
+ * variables set inside a branch are discarded.
+ *
+ * It also accepts "shard" markers, which only matter when a script is split into shards by a
+ * ScriptSharder and are passed over when it runs as a whole.
+ */
+class ParallelExecutor : public BaseExecutor {
+public:
+    using Commands = std::vector<std::vector<std::string>>;
+
+    /**
+     * Starts the branches of a block. The script continues after the block once they have all
+     * finished, which may be after the runner returns.
+     */
+    using BranchRunner = std::function<void(std::vector<Commands> branches)>;
+
+    /**
+     * Constructs a ParallelExecutor.
+     *
+     * @param executor The executor whose commands contain the parallel blocks.
+     * @param runBranches Starts the branches of each block.
+     */
+    ParallelExecutor(std::shared_ptr<CommandExecutor> executor, BranchRunner runBranches);
+
+    /**
+     * Executes parallel_start, branch, parallel_end or shard. Only parallel_start does any work;
+     * it starts the branches of the block and moves execution to its parallel_end.
+     */
+    void execute(const std::vector<std::string> &args) override;
+
+private:
+    /**
+     * Splits the block opened at startIndex into its branches.
+     *
+     * @param startIndex The index of the parallel_start command.
+     * @param endIndex Set to the index of the matching parallel_end.
+     * @return The commands of each non-empty branch.
+     */
+    std::vector<Commands> collectBranches(size_t startIndex, size_t &endIndex) const;
+
+    std::shared_ptr<CommandExecutor> executor;
+    BranchRunner runBranches;
+};
+
+#endif // OTTO_PARALLEL_EXECUTOR_H
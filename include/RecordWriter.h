@@ -0,0 +1,133 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_RECORDWRITER_H
+#define OTTO_RECORDWRITER_H
+
+#include "InputRecord.h"
+#include "KeyMap.h"
+#include "ScriptEncoder.h"
+#include "SpscRing.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * On-disk formats supported by RecordWriter.
+ */
+enum class RecordFormat {
+    Text,  ///< A commands file that can be replayed directly.
+    Binary ///< Fixed-size InputRecords behind a CaptureFileHeader; see InputRecord.h.
+};
+
+/**
+ * RecordWriter streams recorded key events to a file from a dedicated writer thread.
+ *
+ * The capture side only copies fixed-size records into a lock-free ring, so memory use is
+ * constant regardless of session length. The writer thread either encodes the records as
+ * script commands or appends them verbatim in the binary capture format, writes them in
+ * batches and periodically flushes them to stable storage.
+ */
+class RecordWriter {
+public:
+    /**
+     * Constructs a RecordWriter that resolves key names through the given key map.
+     *
+     * @param keyMap The key map used to name recorded key codes.
+     */
+    explicit RecordWriter(const KeyMap &keyMap);
+
+    ~RecordWriter();
+
+    /**
+     * Opens the output file and starts the writer thread.
+     *
+     * @param outputFile The path to the output file.
+     * @param format The format to write.
+     * @throws std::runtime_error If the output file cannot be opened.
+     */
+    void start(const std::string &outputFile, RecordFormat format = RecordFormat::Text);
+
+    /**
+     * Drains all queued records, flushes the file and stops the writer thread.
+     */
+    void stop();
+
+    /**
+     * Queues a record for writing. Must only be called from a single producer thread.
+     *
+     * @param record The record to queue.
+     * @return True if the record was queued, false if the ring was full and it was dropped.
+     */
+    bool push(const InputRecord &record);
+
+    /**
+     * Queues a record, waiting for room if the ring is full, for producers that must not drop
+     * records. Must only be called from a single producer thread.
+     *
+     * @param record The record to queue.
+     */
+    void pushWaiting(const InputRecord &record);
+
+    /**
+     * Describes a capture device. Must be called before the device's first record is pushed.
+     *
+     * @param deviceId The id used in the device's records.
+     * @param name A human-readable device name.
+     * @param capabilities The device's capabilities, written for raw captures; may be null.
+     */
+    void addDevice(uint16_t deviceId, const std::string &name,
+                   const CaptureDeviceCapabilities *capabilities = nullptr);
+
+private:
+    static constexpr size_t RingCapacity = 16384; ///< Room for bursts of raw pointer and touch events.
+    static constexpr int FlushIntervalMs = 1000;
+    static constexpr int IdleSleepMs = 20;
+
+    struct DeviceInfo {
+        uint16_t id;
+        std::string name;
+        std::string capabilities; ///< A CaptureDeviceCapabilities, or empty.
+    };
+
+    void writerLoop();
+    void drain();
+    void drainDevices();
+    void appendMetadata(uint16_t type, uint16_t deviceId, const std::string &payload);
+    void flush(bool sync);
+
+    ScriptEncoder encoder;
+    RecordFormat format = RecordFormat::Text;
+    std::mutex deviceMutex;
+    std::vector<DeviceInfo> newDevices; ///< Devices announced but not yet written, guarded by deviceMutex.
+    std::vector<bool> writtenDevices;   ///< Device ids already described in the output.
+    SpscRing<InputRecord, RingCapacity> ring;
+    std::atomic<bool> isRunning{false};
+    std::atomic<unsigned long> droppedRecords{0};
+    std::thread writerThread;
+    std::string pending;
+    std::string filePath;
+    int fd = -1;
+    bool unsynced = false;
+};
+
+#endif // OTTO_RECORDWRITER_H
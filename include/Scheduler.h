@@ -0,0 +1,145 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCHEDULER_H
+#define OTTO_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Scheduler resumes tasks on a small pool of worker threads once they are due, so any number
+ * of waiting scripts share a few threads instead of sleeping on one each.
+ *
+ * Timed tasks are kept in a hashed timer wheel with one slot per millisecond tick. Scheduling
+ * and expiring a task take constant time, and the timer thread sleeps until the next occupied
+ * slot. Tasks due more than one turn of the wheel ahead stay in their slot until their turn.
+ */
+class Scheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * A unit of work that suspends itself by scheduling its own resumption.
+     */
+    class Task {
+    public:
+        virtual ~Task() = default;
+
+        /**
+         * Runs the task on a worker thread until it has to wait again.
+         *
+         * @param scheduler The scheduler running the task.
+         */
+        virtual void resume(Scheduler &scheduler) = 0;
+
+    private:
+        friend class Scheduler;
+
+        Task *nextTimer = nullptr; ///< Next task in the same wheel slot.
+        int64_t dueTick = 0;
+        bool inWheel = false;
+        bool wakeRequested = false; ///< Woken while not in the wheel; the next schedule() is immediate.
+    };
+
+    /**
+     * Starts the timer thread and the workers.
+     *
+     * @param workers The number of worker threads; at least one is started.
+     */
+    explicit Scheduler(size_t workers);
+
+    /**
+     * Stops all threads. Tasks that are still scheduled are dropped without being resumed.
+     */
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    Scheduler &operator=(const Scheduler &) = delete;
+
+    /**
+     * Schedules a task to be resumed at a point in time, or as soon as possible if that has
+     * passed. A task must not be scheduled again before it has been resumed.
+     *
+     * @param task The task to resume.
+     * @param due When to resume it.
+     */
+    void schedule(Task &task, Clock::time_point due);
+
+    /**
+     * Schedules a task to be resumed as soon as possible.
+     *
+     * @param task The task to resume.
+     */
+    void schedule(Task &task);
+
+    /**
+     * Resumes a task that waits in the timer wheel as soon as possible, e.g. because what it
+     * waits for has happened. If it is not waiting, its next schedule() resumes it immediately.
+     *
+     * @param task The task to wake.
+     */
+    void wake(Task &task);
+
+private:
+    static constexpr size_t WheelSlots = 1024;
+    static constexpr std::chrono::milliseconds TickDuration{1};
+
+    void timerLoop();
+    void workerLoop();
+
+    /**
+     * Moves the tasks of the current tick's slot that are due to the ready queue.
+     *
+     * @return The number of tasks made ready.
+     */
+    size_t expireSlot();
+
+    /**
+     * @return The first tick after the current one whose slot holds a task, at most one turn ahead.
+     */
+    int64_t nextOccupiedTick() const;
+
+    /**
+     * @return The last tick that started at or before a point in time.
+     */
+    int64_t tickOf(Clock::time_point time) const;
+
+    Clock::time_point tickTime(int64_t tick) const;
+
+    const Clock::time_point epoch;
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::condition_variable timerCondition;
+    std::deque<Task *> readyTasks;
+    std::vector<Task *> wheel;
+    size_t timerCount = 0;
+    int64_t currentTick = 0; ///< Last tick whose slot has been expired.
+    bool stopping = false;
+    std::thread timerThread;
+    std::vector<std::thread> workers;
+};
+
+#endif // OTTO_SCHEDULER_H
@@ -0,0 +1,102 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCRIPTANALYZER_H
+#define OTTO_SCRIPTANALYZER_H
+
+#include "CommandExecutor.h"
+#include "KeyMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * What analyzing a commands file found.
+ */
+struct ScriptAnalysis {
+    std::string commandsFile;
+    std::vector<std::string> problems; ///< Invalid commands or arguments; the estimates are only set if empty.
+    size_t commandCount = 0;
+    int64_t durationMs = 0; ///< Expected run time, including the final waits.
+    size_t keyEvents = 0;   ///< Key events injected, counting every press, release and repeat.
+    size_t appActions = 0;  ///< Apps launched and closed.
+};
+
+/**
+ * ScriptAnalyzer checks commands files and estimates what running them takes, without sending
+ * any events or contacting any apps.
+ *
+ * The commands, their arguments, key names and the nesting of loops and parallel blocks are
+ * checked first. A valid file is then run on a simulated timeline, which takes no time but uses
+ * the same code as a real run, so the estimates follow loop counts, the key interval, the speed
+ * factor and the time apps are given to settle exactly. Waits for keys and log lines count as
+ * ending at once.
+ */
+class ScriptAnalyzer {
+public:
+    /**
+     * Constructs an analyzer for the settings the files will be run with.
+     *
+     * @param intervalMs Time between the press and release of a key press.
+     * @param speed Replay speed factor applied to waits and holds.
+     */
+    ScriptAnalyzer(int intervalMs, double speed);
+
+    /**
+     * Analyzes a commands file.
+     *
+     * @param commandsFile The commands file.
+     * @return The analysis; errors are reported in it rather than thrown.
+     */
+    ScriptAnalysis analyze(const std::string &commandsFile) const;
+
+    /**
+     * Analyzes commands that have been parsed already, e.g. a shard of a script.
+     *
+     * @param name The name the commands are reported under.
+     * @param commands The commands.
+     * @return The analysis; errors are reported in it rather than thrown.
+     */
+    ScriptAnalysis analyze(const std::string &name, const std::vector<std::vector<std::string>> &commands) const;
+
+private:
+    using Command = std::vector<std::string>;
+
+    /**
+     * Checks every command of a script, adding a problem for each mistake found.
+     */
+    void validate(const CommandExecutor &executor, ScriptAnalysis &analysis) const;
+
+    /**
+     * Checks the arguments of one command.
+     *
+     * @return Why the arguments are invalid, or an empty string.
+     */
+    std::string checkArguments(const Command &command) const;
+
+    bool isKey(const std::string &arg) const;
+
+    int intervalMs;
+    double speed;
+    KeyMap keyMap;
+};
+
+#endif // OTTO_SCRIPTANALYZER_H
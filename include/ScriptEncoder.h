@@ -0,0 +1,116 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCRIPTENCODER_H
+#define OTTO_SCRIPTENCODER_H
+
+#include "InputRecord.h"
+#include "KeyMap.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/**
+ * ScriptEncoder turns a stream of captured key events into commands-file text.
+ *
+ * Down, repeat and up events are paired per device and key. Presses are emitted in the order
+ * their keys went down, once the matching release has been seen. The gap between consecutive
+ * presses becomes a "wait" command, and presses that autorepeated or were held for longer than
+ * the hold threshold become "key_hold" commands with the measured duration.
+ *
+ * Presses that overlap, such as a modifier held while another key is pressed, are emitted as
+ * "key_down" and "key_up" commands in the order of their transitions instead, so the replay
+ * holds the same keys together. They are emitted once none of their keys is down any more.
+ */
+class ScriptEncoder {
+public:
+    /**
+     * Constructs a ScriptEncoder that resolves key names through the given key map.
+     *
+     * @param keyMap The key map used to name recorded key codes.
+     * @param logCommands Whether to log each emitted command at INFO level, as live recording does.
+     */
+    explicit ScriptEncoder(const KeyMap &keyMap, bool logCommands = false);
+
+    /**
+     * Discards any state left over from a previous recording.
+     */
+    void reset();
+
+    /**
+     * Returns the preamble written at the start of every recorded script.
+     */
+    std::string header() const;
+
+    /**
+     * Consumes one record and appends any commands it completes.
+     *
+     * @param record The captured event.
+     * @param out The text to append commands to.
+     */
+    void encode(const InputRecord &record, std::string &out);
+
+    /**
+     * Emits presses that are still waiting for a release, e.g. when recording stops.
+     *
+     * @param out The text to append commands to.
+     */
+    void finish(std::string &out);
+
+private:
+    static constexpr int HoldThresholdMs = 400;
+    static constexpr size_t MaxPendingPresses = 32;
+
+    struct PendingPress {
+        uint16_t deviceId;
+        int keyCode;
+        int64_t downUs;
+        int64_t upUs; ///< -1 while the key is still down.
+        int repeats;  ///< Autorepeat events seen while held.
+        int64_t firstRepeatUs;
+        int64_t lastRepeatUs;
+    };
+
+    PendingPress *findOpenPress(const InputRecord &record);
+
+    void emitCompleted(std::string &out, bool force);
+    void emit(const PendingPress &press, int64_t endUs, std::string &out);
+
+    /**
+     * Emits the pending presses, which overlap, as key_down and key_up commands.
+     */
+    void emitOverlapping(std::string &out);
+
+    /**
+     * Emits the wait from the previous emitted transition to a time.
+     */
+    void emitWait(int64_t timestampUs, std::string &out);
+
+    void emitCommand(const std::string &command, std::string &out);
+    std::string getKeyName(int keyCode) const;
+
+    const KeyMap &keyMap;
+    bool logCommands;
+    std::deque<PendingPress> pending;
+    bool overlapping = false; ///< Whether a pending press went down while another was held.
+    int64_t lastTransitionUs = -1; ///< Time of the last key transition emitted.
+};
+
+#endif // OTTO_SCRIPTENCODER_H
@@ -0,0 +1,149 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCRIPTRUNNER_H
+#define OTTO_SCRIPTRUNNER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ScriptTask;
+class SimulatedOutput;
+
+/**
+ * Options for running commands files.
+ */
+struct RunOptions {
+    int intervalMs = 100; ///< Time between the press and release of a key press.
+    double speed = 1.0;   ///< Replay speed factor applied to waits and holds.
+    std::shared_ptr<SimulatedOutput> simulation; ///< Collects the events of simulated runs; null to run for real.
+    bool checkpoints = false;   ///< Write checkpoints while running, to resume from later.
+    std::string checkpointFile; ///< Checkpoint file of a single run; "<commands_file>.checkpoint" if empty.
+    bool resume = false;        ///< Continue from existing checkpoints instead of the start.
+    bool shard = false;         ///< Split commands files into shards that run on separate devices.
+};
+
+/**
+ * The outcome of running one commands file.
+ */
+struct ScriptResult {
+    std::string commandsFile;
+    size_t shard = 0; ///< The 1-based shard of the commands file, or 0 if the whole file was run.
+    bool succeeded = false;
+    std::string error;      ///< Why the script failed; empty on success.
+    int64_t durationMs = 0; ///< Script time if simulated; includes time before a resumed checkpoint.
+
+    /**
+     * @return The commands file, followed by ".shard<n>" for a shard.
+     */
+    std::string getName() const { return shard ? commandsFile + ".shard" + std::to_string(shard) : commandsFile; }
+};
+
+/**
+ * ScriptRunner runs commands files. Every run is a ScriptTask with its own variables, timeline
+ * and command executors, so runs never share script state, and sends its keys to one output
+ * device. Branches of parallel blocks in a run share its output device.
+ *
+ * With a SimulatedOutput, scripts run on simulated timelines: they take no time and send
+ * nothing, and the events they would send are collected by the output instead.
+ */
+class ScriptRunner {
+public:
+    /**
+     * Constructs a runner.
+     *
+     * @param options How scripts are run.
+     * @param outputDevice Index of the output device that key events are sent to.
+     */
+    explicit ScriptRunner(RunOptions options, size_t outputDevice = 0);
+
+    /**
+     * Parses and executes a commands file.
+     *
+     * @param commandsFile The commands file.
+     * @return The outcome; errors are reported in it rather than thrown.
+     */
+    ScriptResult run(const std::string &commandsFile) const;
+
+    /**
+     * Runs a commands file, then runs it again whenever it or a file it includes changes, until
+     * asked to stop. A change made during a run starts the next one as soon as it has finished.
+     * Only changed files are parsed again, and the output devices stay open between runs.
+     *
+     * @param commandsFile The commands file.
+     * @param stop Set, e.g. by a signal handler, to return once the current run has finished.
+     * @throws std::runtime_error If the files cannot be watched.
+     */
+    void watch(const std::string &commandsFile, const std::atomic<bool> &stop) const;
+
+    /**
+     * Runs commands files concurrently, each sending to an output device of its own. A file is
+     * started as soon as a device becomes free. The scripts are resumed by a Scheduler on a few
+     * threads, however many run at once. If the options ask for shards, every file is split by a
+     * ScriptSharder and its shards are run like separate files, the longest first.
+     *
+     * @param commandsFiles The commands files.
+     * @param workers The number of scripts run at once; output devices 0 to workers - 1 must exist.
+     * @param options How scripts are run. A simulated file starts at the script time its device
+     *                became free.
+     * @return One result per file or shard, in the order of commandsFiles.
+     */
+    static std::vector<ScriptResult> runParallel(const std::vector<std::string> &commandsFiles, size_t workers,
+                                                 const RunOptions &options);
+
+private:
+    /**
+     * Parses and executes a commands file.
+     *
+     * @param files If not null, set to the files the commands were read from.
+     */
+    ScriptResult run(const std::string &commandsFile, std::vector<std::string> *files) const;
+
+    /**
+     * A script waiting to be run by runParallel().
+     */
+    struct Job {
+        size_t result; ///< Index of its result.
+        std::vector<std::vector<std::string>> commands;
+        int64_t estimatedMs;
+    };
+
+    /**
+     * Parses commands files into jobs, one per file or shard, and adds a result for each of
+     * them. Files that cannot be parsed or split only get a failed result.
+     */
+    static std::vector<Job> createJobs(const std::vector<std::string> &commandsFiles, size_t workers,
+                                       const RunOptions &options, std::vector<ScriptResult> &results);
+
+    /**
+     * Restores a parsed task from its checkpoint and enables checkpoints, as the options ask.
+     *
+     * @throws std::runtime_error If the checkpoint cannot be used.
+     */
+    static void setUpCheckpoints(ScriptTask &task, const std::string &commandsFile, const RunOptions &options);
+
+    RunOptions options;
+    size_t outputDevice;
+};
+
+#endif // OTTO_SCRIPTRUNNER_H
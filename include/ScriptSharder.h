@@ -0,0 +1,64 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCRIPTSHARDER_H
+#define OTTO_SCRIPTSHARDER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * ScriptSharder splits a script into shards that can run independently on separate devices.
+ *
+ * A script is split at top-level "shard" markers. The commands before the first marker are
+ * its prelude, e.g. variable definitions, and start every shard; each section between markers
+ * becomes a shard of its own:
+ *
+ *     var app YouTube
+ *     shard
+ *     launch_app $app
+ *     shard
+ *     key_press down 20
+ *
+ * A script without markers is split by the iterations of its top-level loop instead, which
+ * must be the last command of the script: its iterations are divided as evenly as possible
+ * over the requested number of shards, each running its share of them after the prelude.
+ */
+class ScriptSharder {
+public:
+    using Commands = std::vector<std::vector<std::string>>;
+
+    /**
+     * Splits a script.
+     *
+     * @param commands The script's commands.
+     * @param maxShards How many shards a loop is split into; sections between markers are
+     *                  never merged, so there may be more of them.
+     * @return The commands of each shard, in script order.
+     * @throws std::runtime_error If the script has neither markers nor a loop it can split.
+     */
+    static std::vector<Commands> split(const Commands &commands, size_t maxShards);
+
+private:
+    static std::vector<Commands> splitAtMarkers(const Commands &commands, const std::vector<size_t> &markers);
+    static std::vector<Commands> splitLoop(const Commands &commands, size_t maxShards);
+};
+
+#endif // OTTO_SCRIPTSHARDER_H
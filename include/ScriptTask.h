@@ -0,0 +1,203 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SCRIPTTASK_H
+#define OTTO_SCRIPTTASK_H
+
+#include "Checkpoint.h"
+#include "CommandExecutor.h"
+#include "KeyManager.h"
+#include "Logger.h"
+#include "LoopExecutor.h"
+#include "ParallelExecutor.h"
+#include "Scheduler.h"
+#include "Timeline.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * ScriptTask is the interpreter of one running script: its variables, timeline, key manager
+ * and command executors, and how far it has got.
+ *
+ * A task is an explicit continuation. It executes commands until one schedules work on the
+ * timeline, then stops and reports when it has to continue; nothing blocks in between. A task
+ * can be run on the calling thread, which sleeps until then, or on a Scheduler, which resumes
+ * it on one of its workers so that many scripts share a few threads. Branches of parallel
+ * blocks are tasks of their own, run the same way as the script they belong to.
+ */
+class ScriptTask : public Scheduler::Task {
+public:
+    using Variables = std::unordered_map<std::string, std::string>;
+
+    /**
+     * Called on a worker thread once a task run on a Scheduler has finished.
+     */
+    using FinishedCallback = std::function<void(ScriptTask &task)>;
+
+    /**
+     * Constructs a task; its commands are set through getCommandExecutor().
+     *
+     * @param timeline The timeline the script starts with.
+     * @param intervalMs Time between the press and release of a key press.
+     * @param outputDevice Index of the output device that key events are sent to.
+     * @param logContext Shown with every message logged by the script.
+     * @param variables The variables the script starts with.
+     */
+    ScriptTask(const Timeline &timeline, int intervalMs, size_t outputDevice, std::string logContext = std::string(),
+               Variables variables = Variables());
+
+    std::shared_ptr<CommandExecutor> getCommandExecutor() const;
+
+    /**
+     * @return The script's timeline, e.g. to read how far a simulated script has got.
+     */
+    const Timeline &getTimeline() const;
+
+    /**
+     * Limits what the script and its parallel branches log, without changing the global level.
+     *
+     * @param level The lowest level logged while the script runs.
+     */
+    void setMinLogLevel(LogLevel level);
+
+    /**
+     * Writes a checkpoint to a file every CheckpointIntervalMs of script time, between two
+     * commands, and removes the file once the script has succeeded. The commands must be set
+     * already. A script continued from the checkpoint repeats at most the commands of the last
+     * interval.
+     *
+     * @param filePath The checkpoint file.
+     */
+    void enableCheckpoints(std::string filePath);
+
+    /**
+     * Continues the script from a checkpoint instead of its first command. The commands must be
+     * set already.
+     *
+     * @param checkpoint The checkpoint.
+     * @throws std::runtime_error If the checkpoint belongs to different commands.
+     */
+    void restore(const Checkpoint &checkpoint);
+
+    /**
+     * @return The script time spent so far, including time before the checkpoint it continues from.
+     */
+    int64_t getElapsedMs() const;
+
+    /**
+     * Runs the script to completion on the calling thread.
+     */
+    void run();
+
+    /**
+     * Starts running the script on a scheduler. The task must stay alive until it has finished.
+     * Its key reports are queued by output device, so they keep the script's order whichever
+     * worker resumes it.
+     *
+     * @param scheduler The scheduler to run on.
+     * @param onFinished Called once the script has finished.
+     */
+    void start(Scheduler &scheduler, FinishedCallback onFinished);
+
+    bool succeeded() const;
+
+    /**
+     * @return Why the script failed; empty if it succeeded.
+     */
+    const std::string &getError() const;
+
+    void resume(Scheduler &scheduler) override;
+
+private:
+    static constexpr int CheckpointIntervalMs = 10000;
+
+    enum class State { Waiting, Joining, Finished };
+
+    /**
+     * Executes commands until the script has to wait or has finished.
+     *
+     * @param wakeAt Set to when the script continues if it has to wait for its timeline.
+     * @return Waiting for the timeline, Joining while branches run, or Finished.
+     */
+    State advance(Timeline::Clock::time_point &wakeAt);
+
+    /**
+     * Starts the branches of a parallel block. Without a scheduler they run on threads of their
+     * own and have finished on return.
+     */
+    void runBranches(std::vector<ParallelExecutor::Commands> branches);
+
+    /**
+     * Collects the outcome of finished branches.
+     *
+     * @throws std::runtime_error If a branch failed.
+     */
+    void joinBranches();
+
+    /**
+     * Writes a checkpoint if one is due. Failing to write one is logged, not fatal.
+     */
+    void writeCheckpoint();
+
+    /**
+     * Records why the script failed.
+     */
+    void fail(const std::string &reason);
+
+    /**
+     * Continues the script early because a signal ended the wait on its timeline.
+     */
+    void wake();
+
+    Variables variables;
+    Timeline timeline;
+    KeyManager keyManager;
+    std::shared_ptr<CommandExecutor> executor;
+    std::shared_ptr<LoopExecutor> loopExecutor;
+    int intervalMs;
+    size_t outputDevice;
+    std::string logContext;
+    LogLevel minLogLevel = LogLevel::TRACE;
+    Timeline::Clock::time_point startedAt;
+    int64_t restoredElapsedMs = 0;
+    std::string checkpointPath;
+    uint64_t checkpointScriptHash = 0;
+    Timeline::Clock::time_point lastCheckpoint;
+
+    Scheduler *scheduler = nullptr;
+    FinishedCallback onFinished;
+    std::vector<std::unique_ptr<ScriptTask>> branches;
+    std::atomic<size_t> runningBranches{0}; ///< Branches still running, plus one held by the task itself.
+    bool success = false;
+    std::string error;
+
+    std::mutex wakeMutex; ///< Guards woken while running on the calling thread.
+    std::condition_variable wakeCondition;
+    bool woken = false;
+};
+
+#endif // OTTO_SCRIPTTASK_H
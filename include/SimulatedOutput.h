@@ -0,0 +1,105 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SIMULATEDOUTPUT_H
+#define OTTO_SIMULATEDOUTPUT_H
+
+#include "InjectionQueue.h"
+#include "RecordWriter.h"
+#include "Timeline.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * SimulatedOutput stands in for the output devices when scripts are simulated. Timelines in
+ * simulation hand it their key reports instead of sending them, timed by virtual time, so it
+ * holds the exact event timeline a real run would produce without touching any device. The
+ * timeline can be written as a commands file or a binary capture, and replayed from there.
+ */
+class SimulatedOutput {
+public:
+    /**
+     * Constructs an output whose virtual time starts now.
+     *
+     * @param keepTrace Whether to keep the events sent, for writeTrace(); otherwise they are
+     *                  only counted. At most MaxTraceEvents are kept.
+     */
+    explicit SimulatedOutput(bool keepTrace = false);
+
+    /**
+     * @return The virtual time that simulated scripts start at.
+     */
+    Timeline::Clock::time_point getStart() const;
+
+    /**
+     * Records a key report. Thread safe.
+     *
+     * @param due The virtual time the report is sent at.
+     * @param outputDevice Index of the output device it is sent to.
+     * @param events The key events of the report.
+     */
+    void send(Timeline::Clock::time_point due, size_t outputDevice, const std::vector<KeyEvent> &events);
+
+    /**
+     * Counts an app launched or closed; the app itself is not contacted. Thread safe.
+     */
+    void countAppAction();
+
+    size_t getEventCount() const;
+
+    size_t getAppActionCount() const;
+
+    /**
+     * Logs how many events were sent and how long the simulated run took.
+     */
+    void logSummary() const;
+
+    /**
+     * Writes the events kept so far in the order of their virtual time. The trace ends early if
+     * more than MaxTraceEvents were sent.
+     *
+     * @param outputFile The file to write.
+     * @param format Text writes a commands file, Binary a capture file with the exact timing.
+     * @throws std::runtime_error If the file cannot be opened.
+     */
+    void writeTrace(const std::string &outputFile, RecordFormat format) const;
+
+    static constexpr size_t MaxTraceEvents = 1 << 20; ///< About 32 MB of events.
+
+private:
+    struct SentEvent {
+        int64_t timestampUs; ///< Virtual time since the start.
+        size_t outputDevice;
+        KeyEvent event;
+    };
+
+    Timeline::Clock::time_point start;
+    mutable std::mutex mutex;
+    bool keepTrace;
+    std::vector<SentEvent> events; ///< Kept for the trace in the order they were sent, guarded by mutex.
+    size_t eventCount = 0;         ///< Guarded by mutex.
+    int64_t endUs = 0;             ///< Virtual time of the last event, guarded by mutex.
+    size_t appActions = 0;         ///< Guarded by mutex.
+};
+
+#endif // OTTO_SIMULATEDOUTPUT_H
@@ -0,0 +1,93 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_SPSCRING_H
+#define OTTO_SPSCRING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Bounded single-producer/single-consumer lock-free ring buffer.
+ *
+ * Exactly one thread may call tryPush() and exactly one other thread may call tryPop().
+ * Capacity must be a power of two; one slot is never left unused because head and tail
+ * are free-running counters.
+ */
+template <typename T, size_t Capacity> class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    /**
+     * Appends an element to the ring.
+     *
+     * @param item The element to append.
+     * @return True if the element was queued, false if the ring is full.
+     */
+    bool tryPush(const T &item) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead == Capacity) {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead == Capacity) {
+                return false;
+            }
+        }
+        slots[tail & (Capacity - 1)] = item;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Removes the oldest element from the ring.
+     *
+     * @param item Receives the removed element.
+     * @return True if an element was removed, false if the ring is empty.
+     */
+    bool tryPop(T &item) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail) {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail) {
+                return false;
+            }
+        }
+        item = slots[head & (Capacity - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Checks whether the ring is empty. Only meaningful from the consumer thread.
+     */
+    bool empty() const {
+        return headIndex.load(std::memory_order_relaxed) == tailIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t CacheLine = 64;
+
+    alignas(CacheLine) std::atomic<size_t> headIndex{0}; ///< Next slot to read, owned by the consumer.
+    size_t cachedTail = 0;                               ///< Consumer's last observed tail.
+    alignas(CacheLine) std::atomic<size_t> tailIndex{0}; ///< Next slot to write, owned by the producer.
+    size_t cachedHead = 0;                               ///< Producer's last observed head.
+    alignas(CacheLine) std::array<T, Capacity> slots{};
+};
+
+#endif // OTTO_SPSCRING_H
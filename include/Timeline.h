@@ -0,0 +1,212 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_TIMELINE_H
+#define OTTO_TIMELINE_H
+
+#include "InjectionQueue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SimulatedOutput;
+
+/**
+ * Timeline paces script execution.
+ *
+ * In relative mode every wait sleeps for its own duration, which is how hand-written scripts
+ * behave. In absolute mode waits advance a deadline measured from the point the mode was
+ * enabled, so the time spent sending keys is absorbed instead of accumulating as drift. This
+ * is what recorded scripts use to reproduce the original gaps between presses.
+ *
+ * Commands never sleep themselves. They schedule their key reports and pauses on the timeline,
+ * and the interpreter sends them when they are due: by sleeping in between, or by suspending
+ * the script so that the thread can run other scripts meanwhile.
+ *
+ * A simulated timeline keeps virtual time instead of reading the clock. Reports are handed to
+ * a SimulatedOutput rather than a device, and time jumps straight to each one as it becomes
+ * next, so a script runs in no time while producing the timeline a real run would.
+ */
+class Timeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Mode { Relative, Absolute };
+
+    /**
+     * Ends a wait early when something other than time happens, e.g. a key event.
+     */
+    class Signal {
+    public:
+        explicit Signal(std::function<void()> waker);
+
+        /**
+         * Ends the wait and wakes the script. Thread safe.
+         */
+        void notify();
+
+        bool isNotified() const;
+
+    private:
+        std::atomic<bool> notified{false};
+        std::function<void()> waker;
+    };
+
+    /**
+     * Constructs a Timeline.
+     *
+     * @param speed Replay speed factor; durations are divided by it (e.g. 2.0 runs twice as fast).
+     */
+    explicit Timeline(double speed = 1.0);
+
+    /**
+     * Switches between relative and absolute pacing. Enabling absolute mode anchors the
+     * timeline at the current time.
+     *
+     * @param mode The pacing mode.
+     */
+    void setMode(Mode mode);
+
+    Mode getMode() const;
+
+    /**
+     * Schedules a pause for a script-level duration according to the current mode.
+     *
+     * @param durationMs The unscaled duration in milliseconds.
+     */
+    void wait(int durationMs);
+
+    /**
+     * @return The current time, which scheduled reports are timed against; virtual time if simulated.
+     */
+    Clock::time_point now() const;
+
+    /**
+     * Switches the timeline to virtual time.
+     *
+     * @param output Receives the reports instead of the output devices.
+     * @param start The virtual time to start at.
+     */
+    void simulate(std::shared_ptr<SimulatedOutput> output, Clock::time_point start);
+
+    /**
+     * @return The output that reports go to if the timeline is simulated, otherwise null.
+     */
+    const std::shared_ptr<SimulatedOutput> &getSimulatedOutput() const;
+
+    bool isSimulated() const;
+
+    /**
+     * Moves virtual time forward to a point reached elsewhere, e.g. by the last branch of a
+     * parallel block to finish. Does nothing unless simulated.
+     *
+     * @param time The time to move to, if it is later than now.
+     */
+    void catchUp(Clock::time_point time);
+
+    /**
+     * Schedules a key report to be sent at a point in time. Reports are sent in the order they
+     * are scheduled; one without events only holds the script until it is due.
+     *
+     * @param due When to send the report.
+     * @param outputDevice Index of the output device to send it to.
+     * @param events The key events of the report.
+     */
+    void schedule(Clock::time_point due, size_t outputDevice = 0, std::vector<KeyEvent> events = {});
+
+    /**
+     * Sets how the script running on this timeline is woken when a signal ends a wait early.
+     *
+     * @param waker Wakes the script; called from any thread.
+     */
+    void setWaker(std::function<void()> waker);
+
+    /**
+     * Holds the script until the returned signal is notified or a timeout passes.
+     *
+     * @param timeout When to stop waiting; Clock::time_point::max() to wait without a timeout.
+     * @param done Called on the script's thread when the wait ends, with whether the signal ended
+     *             it. It may throw to fail the script.
+     * @return The signal that ends the wait.
+     */
+    std::shared_ptr<Signal> await(Clock::time_point timeout, std::function<void(bool signalled)> done);
+
+    /**
+     * @return Whether scheduled reports are still waiting to be sent.
+     */
+    bool hasPending() const;
+
+    /**
+     * @return When the next scheduled report is due, or Clock::time_point::max() if it waits
+     *         for a signal only; only valid if hasPending().
+     */
+    Clock::time_point nextDue() const;
+
+    /**
+     * Sends the scheduled reports that are due, and ends the waits that are over. If simulated,
+     * every report is due: time moves to it, and waits for a signal end as if it came at once.
+     */
+    void dispatchDue();
+
+    /**
+     * Scales a duration by the replay speed.
+     *
+     * @param durationMs The unscaled duration in milliseconds.
+     * @return The scaled duration in milliseconds.
+     */
+    int scale(int durationMs) const;
+
+    double getSpeed() const;
+
+    /**
+     * Parses a duration string and converts it to milliseconds.
+     *
+     * @param durationStr The duration string (e.g., "250ms", "5s", "2m").
+     * @return The equivalent duration in milliseconds, or -1 if invalid.
+     */
+    static int parseDuration(const std::string &durationStr);
+
+private:
+    /**
+     * A key report waiting to be sent.
+     */
+    struct TimedReport {
+        Clock::time_point due;
+        size_t outputDevice;
+        std::vector<KeyEvent> events;
+        std::shared_ptr<Signal> signal;         ///< Ends the wait before it is due; only for waits.
+        std::function<void(bool)> done;        ///< Called when the wait ends; only for waits.
+    };
+
+    double speed;
+    Mode mode = Mode::Relative;
+    Clock::time_point deadline;
+    std::deque<TimedReport> pending;
+    std::function<void()> waker;
+    std::shared_ptr<SimulatedOutput> simulatedOutput;
+    Clock::time_point simulatedNow;
+};
+
+#endif // OTTO_TIMELINE_H
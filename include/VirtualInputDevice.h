@@ -0,0 +1,74 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OTTO_VIRTUALINPUTDEVICE_H
+#define OTTO_VIRTUALINPUTDEVICE_H
+
+#include "InputRecord.h"
+
+#include <string>
+#include <vector>
+
+struct input_event;
+
+/**
+ * VirtualInputDevice is a uinput device created from captured device capabilities, used to
+ * replay raw evdev streams such as pointer motion, touch or motion sensors.
+ *
+ * Events are collected into frames and each frame is written to the device with a single
+ * write() when its SYN_REPORT arrives, so the device sees the same reports as the original.
+ */
+class VirtualInputDevice {
+public:
+    /**
+     * Creates a uinput device that reports the given capabilities.
+     *
+     * @param name The name of the captured device; the virtual device's name is derived from it.
+     * @param capabilities The captured device's capabilities.
+     * @throws std::runtime_error If the device cannot be created.
+     */
+    VirtualInputDevice(const std::string &name, const CaptureDeviceCapabilities &capabilities);
+
+    ~VirtualInputDevice();
+
+    VirtualInputDevice(const VirtualInputDevice &) = delete;
+    VirtualInputDevice &operator=(const VirtualInputDevice &) = delete;
+
+    /**
+     * Adds an event to the current frame.
+     *
+     * @param record The captured event.
+     * @return True if the event completes the frame, which is then ready for writeFrame().
+     */
+    bool append(const InputRecord &record);
+
+    /**
+     * Writes the current frame to the device and starts a new one.
+     *
+     * @return False if the write failed.
+     */
+    bool writeFrame();
+
+private:
+    int fd = -1;
+    std::string deviceName;
+    std::vector<struct input_event> frame;
+};
+
+#endif // OTTO_VIRTUALINPUTDEVICE_H
@@ -21,29 +21,63 @@
 #define OTTO_WAITEXECUTOR_H
 
 #include "BaseExecutor.h"
+#include "KeyMap.h"
+#include "Timeline.h"
+#include <memory>
+#include <regex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /**
- * WaitExecutor handles "wait" commands to introduce delays.
+ * WaitExecutor handles "wait" commands to introduce delays, "timeline" commands
+ * to select how those delays are paced, and "wait_for_key" and "wait_for_log" commands
+ * that wait for a key event on the input devices or a line in a log file instead of a fixed time.
  */
 class WaitExecutor : public BaseExecutor {
 public:
     /**
-     * Executes the "wait" command.
+     * Constructs a WaitExecutor that paces waits on the given timeline.
+     *
+     * @param timeline The script's timeline.
+     */
+    explicit WaitExecutor(Timeline &timeline);
+
+    /**
+     * Executes the "wait", "timeline", "wait_for_key" or "wait_for_log" command.
      * 
-     * @param args The arguments for the command (e.g., ["wait", "5s"]).
+     * @param args The arguments for the command (e.g., ["wait", "5s"] or ["timeline", "absolute"]).
      */
     void execute(const std::vector<std::string> &args) override;
 
 private:
     /**
-     * Parses a duration string and converts it to milliseconds.
-     * 
-     * @param durationStr The duration string (e.g., "5s", "2m").
-     * @return The equivalent duration in milliseconds, or -1 if invalid.
+     * Holds the script until a key is pressed on an input device, or fails it on timeout.
+     */
+    void executeWaitForKey(const std::vector<std::string> &args);
+
+    /**
+     * Holds the script until a line matching a pattern is written to a log file, or fails it on timeout.
      */
-    int parseDuration(const std::string &durationStr) const;
+    void executeWaitForLog(const std::vector<std::string> &args);
+
+    /**
+     * Parses an optional timeout argument.
+     *
+     * @return The timeout in milliseconds, -1 for no timeout, or -2 if the duration is invalid.
+     */
+    static int parseTimeout(const std::vector<std::string> &args, size_t index);
+
+    /**
+     * Returns the compiled pattern, compiling it only the first time it is used, e.g. in a loop.
+     *
+     * @throws std::regex_error if the pattern is invalid.
+     */
+    std::shared_ptr<const std::regex> getPattern(const std::string &pattern);
+
+    Timeline &timeline;
+    KeyMap keyMap;
+    std::unordered_map<std::string, std::shared_ptr<const std::regex>> patterns;
 };
 
 #endif // OTTO_WAITEXECUTOR_H
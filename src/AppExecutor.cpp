@@ -18,12 +18,20 @@
 */
 
 #include "AppExecutor.h"
+#include "HttpRequester.h"
 #include "Logger.h"
+#include "SimulatedOutput.h"
 
 #include <chrono>
-#include <cstdlib>
-#include <stdexcept>
-#include <thread>
+#include <memory>
+
+AppExecutor::AppExecutor(Timeline &timeline) : timeline(timeline) {}
+
+AppExecutor::~AppExecutor() {
+    if (requestId != NoRequest) {
+        HttpRequester::getInstance().cancel(requestId);
+    }
+}
 
 void AppExecutor::execute(const std::vector<std::string> &args) {
     if (args.size() != 2) {
@@ -46,19 +54,28 @@ void AppExecutor::execute(const std::vector<std::string> &args) {
         return;
     }
 
-    try {
-        sendHttpRequest(url);
+    if (timeline.isSimulated()) {
+        timeline.getSimulatedOutput()->countAppAction();
         logDebug("Command executed: " + command + " for app: " + appId);
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-    } catch (const std::exception &e) {
-        logError("Failed to execute command: " + command + " for app: " + appId + ". Error: " + e.what());
+        timeline.schedule(timeline.now() + std::chrono::milliseconds(AppSettleMs));
+        return;
     }
-}
 
-void AppExecutor::sendHttpRequest(const std::string &url) {
-    std::string command = "curl \"" + url + "\" -X POST --data ' '";
-    int result = std::system(command.c_str());
-    if (result != 0) {
-        throw std::runtime_error("HTTP request failed with error code: " + std::to_string(result));
-    }
+    auto status = std::make_shared<int>(0);
+    auto signal = timeline.await(Timeline::Clock::time_point::max(), [this, command, appId, status](bool) {
+        requestId = NoRequest;
+        if (*status != 0) {
+            logError("Failed to execute command: " + command + " for app: " + appId +
+                     ". Error: HTTP request failed with error code: " + std::to_string(*status));
+            return;
+        }
+        logDebug("Command executed: " + command + " for app: " + appId);
+        timeline.schedule(timeline.now() + std::chrono::milliseconds(AppSettleMs));
+    });
+
+    // The status is written before notify() and read after the wake-up it causes.
+    requestId = HttpRequester::getInstance().post(url, [signal, status](int result) {
+        *status = result;
+        signal->notify();
+    });
 }
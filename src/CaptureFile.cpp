@@ -0,0 +1,121 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CaptureFile.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+CaptureFile::CaptureFile(const std::string &filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        logError("Failed to open capture file: " + filePath);
+        throw std::runtime_error("Could not open capture file.");
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(CaptureFileHeader)) {
+        close(fd);
+        throw std::runtime_error("Capture file is truncated: " + filePath);
+    }
+
+    mappingSize = static_cast<size_t>(st.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map capture file: " + filePath);
+    }
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    const auto *header = static_cast<const CaptureFileHeader *>(mapping);
+    if (memcmp(header->magic, CaptureMagic, sizeof(CaptureMagic)) != 0 || header->version != CaptureVersion ||
+        header->recordSize != sizeof(InputRecord)) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        throw std::runtime_error("Unsupported capture file format: " + filePath);
+    }
+
+    // A record cut short by a crash is ignored rather than treated as an error.
+    records = reinterpret_cast<const InputRecord *>(static_cast<const char *>(mapping) + sizeof(CaptureFileHeader));
+    recordCount = (mappingSize - sizeof(CaptureFileHeader)) / sizeof(InputRecord);
+    logDebug("Mapped capture file " + filePath + " with " + std::to_string(recordCount) + " records.");
+}
+
+CaptureFile::~CaptureFile() {
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+}
+
+bool CaptureFile::isCaptureFile(const std::string &filePath) {
+    int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    char magic[sizeof(CaptureMagic)] = {};
+    bool matches = read(fd, magic, sizeof(magic)) == static_cast<ssize_t>(sizeof(magic)) &&
+                   memcmp(magic, CaptureMagic, sizeof(magic)) == 0;
+    close(fd);
+    return matches;
+}
+
+const InputRecord *CaptureFile::next(size_t &index) {
+    while (index < recordCount) {
+        const InputRecord &record = records[index];
+        if (record.type < INPUT_TYPE_DEVICE) {
+            ++index;
+            return &record;
+        }
+
+        size_t payload = payloadRecords(record);
+        if (index + 1 + payload > recordCount) {
+            logWarn("Capture file ends inside a metadata record.");
+            index = recordCount;
+            break;
+        }
+        readMetadata(record, index + 1);
+        index += 1 + payload;
+    }
+    return nullptr;
+}
+
+const std::map<uint16_t, std::string> &CaptureFile::getDeviceNames() const { return deviceNames; }
+
+const std::map<uint16_t, CaptureDeviceCapabilities> &CaptureFile::getDeviceCapabilities() const {
+    return deviceCapabilities;
+}
+
+void CaptureFile::readMetadata(const InputRecord &record, size_t payloadIndex) {
+    const char *payload = reinterpret_cast<const char *>(&records[payloadIndex]);
+    if (record.type == INPUT_TYPE_DEVICE) {
+        deviceNames[record.deviceId] = std::string(payload, static_cast<size_t>(record.value));
+    } else if (record.type == INPUT_TYPE_CAPABILITIES &&
+               static_cast<size_t>(record.value) == sizeof(CaptureDeviceCapabilities)) {
+        memcpy(&deviceCapabilities[record.deviceId], payload, sizeof(CaptureDeviceCapabilities));
+    } else {
+        logDebug("Skipping unknown metadata record type: " + std::to_string(record.type));
+    }
+}
@@ -0,0 +1,163 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Checkpoint.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+static constexpr const char *CheckpointMagic = "otto-checkpoint";
+static constexpr int CheckpointVersion = 1;
+
+void Checkpoint::save(const std::string &filePath) const {
+    std::ostringstream out;
+    out << CheckpointMagic << ' ' << CheckpointVersion << '\n'
+        << "script " << std::hex << scriptHash << std::dec << '\n'
+        << "command " << commandIndex << '\n'
+        << "elapsed " << elapsedMs << '\n'
+        << "timeline " << (mode == Timeline::Mode::Absolute ? "absolute" : "relative") << '\n';
+    for (const auto &loop : loops) {
+        out << "loop " << loop.first << ' ' << loop.second << '\n';
+    }
+    for (int keyCode : heldKeys) {
+        out << "held " << keyCode << '\n';
+    }
+    for (const auto &variable : variables) {
+        out << "var " << variable.first << ' ' << variable.second << '\n';
+    }
+    std::string content = out.str();
+
+    std::string tempPath = filePath + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not write checkpoint " + tempPath + ": " + std::string(strerror(errno)));
+    }
+    bool written = write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()) && fsync(fd) == 0;
+    int error = errno;
+    close(fd);
+    if (!written || std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        if (written) {
+            error = errno;
+        }
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Could not write checkpoint " + filePath + ": " + std::string(strerror(error)));
+    }
+}
+
+bool Checkpoint::load(const std::string &filePath, Checkpoint &checkpoint) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    auto invalid = [&filePath](const std::string &reason) {
+        return std::runtime_error("Invalid checkpoint " + filePath + ": " + reason);
+    };
+
+    std::string line;
+    std::string magic;
+    int version = 0;
+    if (!std::getline(file, line) || !(std::istringstream(line) >> magic >> version) || magic != CheckpointMagic) {
+        throw invalid("not a checkpoint file.");
+    }
+    if (version != CheckpointVersion) {
+        throw invalid("unsupported version " + std::to_string(version) + ".");
+    }
+
+    checkpoint = Checkpoint();
+    bool hasScript = false;
+    bool hasCommand = false;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string field;
+        if (!(fields >> field)) {
+            continue;
+        }
+
+        bool valid = true;
+        if (field == "script") {
+            valid = static_cast<bool>(fields >> std::hex >> checkpoint.scriptHash);
+            hasScript = valid;
+        } else if (field == "command") {
+            valid = static_cast<bool>(fields >> checkpoint.commandIndex);
+            hasCommand = valid;
+        } else if (field == "elapsed") {
+            valid = static_cast<bool>(fields >> checkpoint.elapsedMs);
+        } else if (field == "timeline") {
+            std::string mode;
+            valid = (fields >> mode) && (mode == "absolute" || mode == "relative");
+            checkpoint.mode = mode == "absolute" ? Timeline::Mode::Absolute : Timeline::Mode::Relative;
+        } else if (field == "loop") {
+            std::pair<int, int> loop;
+            valid = (fields >> loop.first >> loop.second) && loop.first >= 0 && loop.second > 0;
+            checkpoint.loops.push_back(loop);
+        } else if (field == "held") {
+            int keyCode = -1;
+            valid = static_cast<bool>(fields >> keyCode);
+            checkpoint.heldKeys.push_back(keyCode);
+        } else if (field == "var") {
+            // The value is the rest of the line, so it may contain spaces.
+            std::string name;
+            std::string value;
+            valid = static_cast<bool>(fields >> name);
+            if (fields.peek() == ' ') {
+                fields.get();
+            }
+            std::getline(fields, value);
+            checkpoint.variables[name] = value;
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            throw invalid("bad line: " + line);
+        }
+    }
+
+    if (!hasScript || !hasCommand) {
+        throw invalid("incomplete.");
+    }
+    return true;
+}
+
+uint64_t Checkpoint::hashCommands(const std::vector<std::vector<std::string>> &commands) {
+    // FNV-1a, which is stable across builds unlike std::hash.
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    };
+
+    for (const auto &command : commands) {
+        for (const auto &token : command) {
+            for (char c : token) {
+                mix(static_cast<unsigned char>(c));
+            }
+            mix(0);
+        }
+        mix('\n');
+    }
+    return hash;
+}
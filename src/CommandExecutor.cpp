@@ -40,6 +40,10 @@ std::shared_ptr<BaseExecutor> CommandExecutor::getExecutor(const std::string &co
     return nullptr;
 }
 
+bool CommandExecutor::hasCommand(const std::string &command) const {
+    return executors.find(command) != executors.end();
+}
+
 void CommandExecutor::execute(const std::vector<std::string> &args) {
     if (args.empty()) {
         logError("No command provided for execution.");
@@ -65,11 +69,15 @@ void CommandExecutor::setParsedCommands(const std::vector<std::vector<std::strin
     logDebug("Parsed commands set successfully. Total commands: " + std::to_string(commands.size()));
 }
 
-void CommandExecutor::executeAll() {
-    while (currentCommandIndex < parsedCommands.size()) {
-        execute(parsedCommands[currentCommandIndex]);
-        ++currentCommandIndex;
+const std::vector<std::vector<std::string>> &CommandExecutor::getParsedCommands() const { return parsedCommands; }
+
+bool CommandExecutor::step() {
+    if (currentCommandIndex >= parsedCommands.size()) {
+        return false;
     }
+    execute(parsedCommands[currentCommandIndex]);
+    ++currentCommandIndex;
+    return true;
 }
 
 size_t CommandExecutor::getCurrentCommandIndex() const { return currentCommandIndex; }
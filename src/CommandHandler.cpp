@@ -20,41 +20,296 @@
 #include "CommandHandler.h"
 #include "Logger.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
 #include <fstream>
-#include <iterator>
-#include <sstream>
+#include <mutex>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <unordered_map>
 
-CommandHandler::CommandHandler(std::shared_ptr<CommandExecutor> executor) : executor(std::move(executor)) {}
+/**
+ * Splits a line into whitespace-separated tokens. A double-quoted token may contain spaces;
+ * inside quotes, \" and \\ stand for a quote and a backslash.
+ */
+static std::vector<std::string> tokenizeLine(const std::string &line) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        if (std::isspace(static_cast<unsigned char>(line[i]))) {
+            ++i;
+            continue;
+        }
 
-void CommandHandler::parseFile(const std::string &filePath) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        logError("Failed to open commands file: " + filePath);
-        throw std::runtime_error("Could not open commands file.");
+        std::string token;
+        if (line[i] == '"') {
+            for (++i; i < line.size() && line[i] != '"'; ++i) {
+                if (line[i] == '\\' && i + 1 < line.size() && (line[i + 1] == '"' || line[i + 1] == '\\')) {
+                    ++i;
+                }
+                token += line[i];
+            }
+            if (i == line.size()) {
+                throw std::runtime_error("Unterminated quoted string: " + line);
+            }
+            ++i;
+        } else {
+            while (i < line.size() && !std::isspace(static_cast<unsigned char>(line[i]))) {
+                token += line[i++];
+            }
+        }
+        tokens.push_back(token);
     }
+    return tokens;
+}
 
-    logDebug("Parsing commands file: " + filePath);
+namespace {
+/**
+ * A tokenized commands file, kept in a per-process cache for as long as the file is unchanged.
+ */
+struct SourceFile {
+    struct Line {
+        size_t number;
+        std::vector<std::string> tokens;
+    };
 
-    std::vector<std::vector<std::string>> parsedCommands;
-    std::string line;
+    std::vector<Line> lines;
+    int64_t mtimeNs;
+    int64_t size;
+};
+
+std::mutex sourceCacheMutex;
+std::unordered_map<std::string, std::shared_ptr<const SourceFile>> sourceCache; ///< By canonical path.
+
+/**
+ * Reads and tokenizes a commands file, or returns it from the cache if it has not changed since.
+ *
+ * @param path The canonical path of the file.
+ * @return The file, or nullptr if it cannot be read.
+ */
+std::shared_ptr<const SourceFile> loadSourceFile(const std::string &path) {
+    struct stat st {};
+    if (stat(path.c_str(), &st) < 0) {
+        return nullptr;
+    }
+    int64_t mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    int64_t size = static_cast<int64_t>(st.st_size);
+
+    {
+        std::lock_guard<std::mutex> lock(sourceCacheMutex);
+        auto it = sourceCache.find(path);
+        if (it != sourceCache.end() && it->second->mtimeNs == mtimeNs && it->second->size == size) {
+            logDebug("Using cached commands file: " + path);
+            return it->second;
+        }
+    }
 
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::vector<std::string> tokens((std::istream_iterator<std::string>(iss)),
-                                        std::istream_iterator<std::string>());
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    logDebug("Parsing commands file: " + path);
 
+    auto source = std::make_shared<SourceFile>();
+    source->mtimeNs = mtimeNs;
+    source->size = size;
+    std::string line;
+    for (size_t number = 1; std::getline(file, line); ++number) {
+        std::vector<std::string> tokens;
+        try {
+            tokens = tokenizeLine(line);
+        } catch (const std::exception &e) {
+            throw std::runtime_error(std::string(e.what()) + " at " + path + ":" + std::to_string(number));
+        }
         if (!tokens.empty()) {
-            parsedCommands.push_back(tokens);
+            source->lines.push_back({number, std::move(tokens)});
         }
     }
 
-    logDebug("Parsed " + std::to_string(parsedCommands.size()) + " commands.");
-    executor->setParsedCommands(parsedCommands);
+    std::lock_guard<std::mutex> lock(sourceCacheMutex);
+    sourceCache[path] = source;
+    return source;
 }
 
-void CommandHandler::executeCommands() {
-    logDebug("Executing commands...");
-    executor->executeAll();
-    logDebug("All commands executed successfully.");
+/**
+ * Resolves include, def and call while loading a script, so the executor only sees plain
+ * commands. Subroutine bodies are inlined at every call with their parameters replaced.
+ */
+class ScriptLoader {
+public:
+    /**
+     * @param files If not null, every file read is added to it, even if loading fails.
+     */
+    explicit ScriptLoader(std::vector<std::string> *files) : files(files) {}
+
+    std::vector<std::vector<std::string>> load(const std::string &filePath) {
+        includeFile(filePath, std::string());
+        return std::move(commands);
+    }
+
+private:
+    static constexpr size_t MaxDepth = 64; ///< Deepest nesting of includes and calls.
+
+    struct Definition {
+        std::vector<std::string> params;
+        std::vector<SourceFile::Line> body;
+        std::string file;
+        size_t line;
+    };
+
+    using Arguments = std::unordered_map<std::string, std::string>;
+
+    void includeFile(const std::string &filePath, const std::string &where) {
+        std::string path = filePath;
+        if (char *resolved = realpath(filePath.c_str(), nullptr)) {
+            path = resolved;
+            free(resolved);
+        }
+        if (files && std::find(files->begin(), files->end(), path) == files->end()) {
+            files->push_back(path);
+        }
+        std::shared_ptr<const SourceFile> source = loadSourceFile(path);
+        if (!source) {
+            if (where.empty()) {
+                logError("Failed to open commands file: " + filePath);
+                throw std::runtime_error("Could not open commands file.");
+            }
+            throw std::runtime_error("Could not open included file " + filePath + " at " + where);
+        }
+
+        if (std::find(includes.begin(), includes.end(), path) != includes.end()) {
+            throw std::runtime_error(path + " includes itself at " + where);
+        }
+        if (includes.size() + calls.size() >= MaxDepth) {
+            throw std::runtime_error("Includes and calls are nested too deeply at " + where);
+        }
+
+        includes.push_back(path);
+        expand(source->lines, path, Arguments());
+        includes.pop_back();
+    }
+
+    void expand(const std::vector<SourceFile::Line> &lines, const std::string &file, const Arguments &arguments) {
+        for (size_t i = 0; i < lines.size(); ++i) {
+            std::vector<std::string> tokens = lines[i].tokens;
+            for (auto &token : tokens) {
+                auto it = token.size() > 1 && token[0] == '$' ? arguments.find(token.substr(1)) : arguments.end();
+                if (it != arguments.end()) {
+                    token = it->second;
+                }
+            }
+            std::string where = file + ":" + std::to_string(lines[i].number);
+            const std::string &command = tokens[0];
+
+            if (command == "include") {
+                if (tokens.size() != 2) {
+                    throw std::runtime_error("Usage: include <file> at " + where);
+                }
+                includeFile(resolvePath(tokens[1], file), where);
+            } else if (command == "def") {
+                i = define(lines, i, tokens, file);
+            } else if (command == "end") {
+                throw std::runtime_error("end without def at " + where);
+            } else if (command == "call") {
+                call(tokens, where);
+            } else {
+                commands.push_back(std::move(tokens));
+            }
+        }
+    }
+
+    /**
+     * Stores the subroutine starting at lines[begin].
+     *
+     * @return The index of its end line.
+     */
+    size_t define(const std::vector<SourceFile::Line> &lines, size_t begin, const std::vector<std::string> &tokens,
+                  const std::string &file) {
+        std::string where = file + ":" + std::to_string(lines[begin].number);
+        if (tokens.size() < 2) {
+            throw std::runtime_error("Usage: def <name> [parameters...] at " + where);
+        }
+
+        Definition definition{{tokens.begin() + 2, tokens.end()}, {}, file, lines[begin].number};
+        size_t end = begin + 1;
+        for (; end < lines.size() && lines[end].tokens[0] != "end"; ++end) {
+            if (lines[end].tokens[0] == "def") {
+                throw std::runtime_error("def inside the body of " + tokens[1] + " at " + file + ":" +
+                                         std::to_string(lines[end].number));
+            }
+            definition.body.push_back(lines[end]);
+        }
+        if (end == lines.size()) {
+            throw std::runtime_error("def " + tokens[1] + " has no end at " + where);
+        }
+
+        // A library included twice defines the same subroutines again, which is harmless
+        auto it = definitions.find(tokens[1]);
+        if (it != definitions.end() && (it->second.file != file || it->second.line != definition.line)) {
+            throw std::runtime_error("Subroutine " + tokens[1] + " defined again at " + where + "; first defined at " +
+                                     it->second.file + ":" + std::to_string(it->second.line));
+        }
+        definitions[tokens[1]] = std::move(definition);
+        return end;
+    }
+
+    void call(const std::vector<std::string> &tokens, const std::string &where) {
+        if (tokens.size() < 2) {
+            throw std::runtime_error("Usage: call <name> [arguments...] at " + where);
+        }
+        auto it = definitions.find(tokens[1]);
+        if (it == definitions.end()) {
+            throw std::runtime_error("Unknown subroutine " + tokens[1] + " at " + where);
+        }
+        const Definition &definition = it->second;
+        if (tokens.size() - 2 != definition.params.size()) {
+            throw std::runtime_error("Subroutine " + tokens[1] + " takes " + std::to_string(definition.params.size()) +
+                                     " argument(s) at " + where);
+        }
+        if (std::find(calls.begin(), calls.end(), tokens[1]) != calls.end()) {
+            throw std::runtime_error("Subroutine " + tokens[1] + " calls itself at " + where);
+        }
+        if (includes.size() + calls.size() >= MaxDepth) {
+            throw std::runtime_error("Includes and calls are nested too deeply at " + where);
+        }
+
+        Arguments arguments;
+        for (size_t i = 0; i < definition.params.size(); ++i) {
+            arguments[definition.params[i]] = tokens[i + 2];
+        }
+        calls.push_back(tokens[1]);
+        expand(definition.body, definition.file, arguments);
+        calls.pop_back();
+    }
+
+    /**
+     * Resolves an included path relative to the directory of the including file.
+     */
+    static std::string resolvePath(const std::string &path, const std::string &includingFile) {
+        size_t slash = includingFile.rfind('/');
+        if (path.empty() || path[0] == '/' || slash == std::string::npos) {
+            return path;
+        }
+        return includingFile.substr(0, slash + 1) + path;
+    }
+
+    std::vector<std::string> *files;
+    std::vector<std::vector<std::string>> commands;
+    std::unordered_map<std::string, Definition> definitions;
+    std::vector<std::string> includes; ///< Files being included, outermost first.
+    std::vector<std::string> calls;    ///< Subroutines being inlined, outermost first.
+};
+} // namespace
+
+CommandHandler::CommandHandler(std::shared_ptr<CommandExecutor> executor) : executor(std::move(executor)) {}
+
+void CommandHandler::parseFile(const std::string &filePath) { executor->setParsedCommands(parseCommands(filePath)); }
+
+std::vector<std::vector<std::string>> CommandHandler::parseCommands(const std::string &filePath,
+                                                                   std::vector<std::string> *files) {
+    std::vector<std::vector<std::string>> parsedCommands = ScriptLoader(files).load(filePath);
+    logDebug("Parsed " + std::to_string(parsedCommands.size()) + " commands.");
+    return parsedCommands;
 }
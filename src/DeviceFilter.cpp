@@ -0,0 +1,155 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DeviceFilter.h"
+#include "KeyMap.h"
+#include "Logger.h"
+
+#include <cstdlib>
+#include <fnmatch.h>
+#include <linux/input.h>
+#include <map>
+#include <stdexcept>
+#include <sys/ioctl.h>
+
+// Parses a non-negative decimal or hex number, returning -1 if the text is not one.
+static int parseNumber(const std::string &text) {
+    char *end = nullptr;
+    long value = std::strtol(text.c_str(), &end, 0);
+    return (end != text.c_str() && *end == '\0' && value >= 0 && value <= INT16_MAX) ? static_cast<int>(value) : -1;
+}
+
+InputDeviceInfo InputDeviceInfo::probe(int fd, const std::string &path) {
+    InputDeviceInfo info;
+    info.path = path;
+
+    char buffer[256] = "";
+    if (ioctl(fd, EVIOCGNAME(sizeof(buffer)), buffer) >= 0) {
+        info.name = buffer;
+    }
+
+    buffer[0] = '\0';
+    if (ioctl(fd, EVIOCGPHYS(sizeof(buffer)), buffer) >= 0) {
+        info.phys = buffer;
+    }
+
+    unsigned long eventBits = 0;
+    if (ioctl(fd, EVIOCGBIT(0, sizeof(eventBits)), &eventBits) >= 0) {
+        info.eventTypes = static_cast<uint32_t>(eventBits);
+    }
+
+    if (info.eventTypes & (1u << EV_KEY)) {
+        unsigned char keyBits[KeyBitCount / 8] = {};
+        if (ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits) >= 0) {
+            for (size_t code = 0; code < KeyBitCount; ++code) {
+                if (keyBits[code / 8] & (1u << (code % 8))) {
+                    info.keyCodes.set(code);
+                }
+            }
+        }
+    }
+
+    return info;
+}
+
+void DeviceFilter::addRule(const std::string &ruleText) {
+    static const std::map<std::string, Field> fields = {{"name", Field::Name},
+                                                        {"phys", Field::Phys},
+                                                        {"path", Field::Path},
+                                                        {"cap", Field::Capability},
+                                                        {"key", Field::Key}};
+    static const std::map<std::string, int> eventTypes = {
+        {"EV_SYN", EV_SYN}, {"EV_KEY", EV_KEY}, {"EV_REL", EV_REL}, {"EV_ABS", EV_ABS}, {"EV_MSC", EV_MSC},
+        {"EV_SW", EV_SW},   {"EV_LED", EV_LED}, {"EV_SND", EV_SND}, {"EV_REP", EV_REP}, {"EV_FF", EV_FF}};
+
+    Rule rule{true, Field::Name, "", -1};
+    std::string text = ruleText;
+    if (!text.empty() && (text[0] == '+' || text[0] == '-')) {
+        rule.include = text[0] == '+';
+        text = text.substr(1);
+    }
+
+    auto separator = text.find(':');
+    if (separator == std::string::npos || separator + 1 == text.size()) {
+        throw std::invalid_argument("Invalid device rule: " + ruleText + ". Expected [+|-]<field>:<pattern>.");
+    }
+
+    auto field = fields.find(text.substr(0, separator));
+    if (field == fields.end()) {
+        throw std::invalid_argument("Unknown device rule field in: " + ruleText +
+                                    ". Use name, phys, path, cap or key.");
+    }
+    rule.field = field->second;
+    rule.pattern = text.substr(separator + 1);
+
+    if (rule.field == Field::Capability) {
+        auto type = eventTypes.find(rule.pattern);
+        rule.number = type != eventTypes.end() ? type->second : parseNumber(rule.pattern);
+        if (rule.number < 0 || rule.number >= EV_CNT) {
+            throw std::invalid_argument("Unknown event type in device rule: " + ruleText);
+        }
+    } else if (rule.field == Field::Key) {
+        rule.number = parseNumber(rule.pattern);
+        if (rule.number < 0) {
+            rule.number = KeyMap().getKeyCode(rule.pattern);
+        }
+        if (rule.number <= 0 || static_cast<size_t>(rule.number) >= InputDeviceInfo::KeyBitCount) {
+            throw std::invalid_argument("Unknown key in device rule: " + ruleText);
+        }
+    }
+
+    rules.push_back(rule);
+    logDebug("Added device rule: " + ruleText);
+}
+
+bool DeviceFilter::matches(const InputDeviceInfo &device) const {
+    bool hasIncludes = false;
+    bool included = false;
+
+    for (const auto &rule : rules) {
+        bool ruleMatch = ruleMatches(rule, device);
+        if (!rule.include && ruleMatch) {
+            return false;
+        }
+        if (rule.include) {
+            hasIncludes = true;
+            included = included || ruleMatch;
+        }
+    }
+
+    return !hasIncludes || included;
+}
+
+bool DeviceFilter::empty() const { return rules.empty(); }
+
+bool DeviceFilter::ruleMatches(const Rule &rule, const InputDeviceInfo &device) {
+    switch (rule.field) {
+    case Field::Name:
+        return fnmatch(rule.pattern.c_str(), device.name.c_str(), 0) == 0;
+    case Field::Phys:
+        return fnmatch(rule.pattern.c_str(), device.phys.c_str(), 0) == 0;
+    case Field::Path:
+        return fnmatch(rule.pattern.c_str(), device.path.c_str(), 0) == 0;
+    case Field::Capability:
+        return (device.eventTypes & (1u << rule.number)) != 0;
+    case Field::Key:
+        return device.keyCodes.test(static_cast<size_t>(rule.number));
+    }
+    return false;
+}
@@ -23,13 +23,15 @@
 #include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <ctime>
 #include <dirent.h>
 #include <fcntl.h>
-#include <fstream>
 #include <linux/input.h>
 #include <poll.h>
 #include <stdexcept>
 #include <string>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -40,17 +42,35 @@
 #include "IARMUtils.h"
 #endif
 
+#ifdef ENABLE_UINPUT
+static const char *const UInputDeviceName = "OttoUInput";
+#endif
+
+size_t EventManager::outputDeviceCount = 1;
+DeviceFilter EventManager::listenDeviceFilter;
+
 EventManager::EventManager() {
     logDebug("EventManager constructor");
 #ifdef ENABLE_UINPUT
     setupUInput();
 #else
     IARMUtils::initialize("OTTO");
+    if (outputDeviceCount > 1) {
+        logWarn("IR key events have a single output; all scripts send to the same IR bus.");
+    }
 #endif
+
+    isInjecting = true;
+    injectorThread = std::thread(&EventManager::injectorLoop, this);
 }
 
 EventManager::~EventManager() {
     stopRecording();
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        stopCapture();
+    }
+    stopInjector();
 #ifdef ENABLE_UINPUT
     cleanupUInput();
 #else
@@ -63,34 +83,110 @@ EventManager &EventManager::getInstance() {
     return instance;
 }
 
-void EventManager::sendEvent(int keyType, int keyCode) {
+void EventManager::setOutputDeviceCount(size_t count) { outputDeviceCount = count > 0 ? count : 1; }
+
+size_t EventManager::getOutputDeviceCount() { return outputDeviceCount; }
+
+void EventManager::sendEvent(int keyType, int keyCode, size_t outputDevice) {
+    KeyEvent event{keyType, keyCode};
+    enqueueEvents(&event, 1, outputDevice);
+}
+
+void EventManager::sendEvents(const std::vector<KeyEvent> &events, size_t outputDevice) {
+    enqueueEvents(events.data(), events.size(), outputDevice);
+}
+
+void EventManager::enqueueEvents(const KeyEvent *events, size_t count, size_t outputDevice, int64_t captureUs) {
+    // Reports larger than a queue entry are split; each part gets its own SYN_REPORT.
+    for (size_t offset = 0; offset < count; offset += InjectionReport::MaxEvents) {
+        InjectionReport report;
+        report.count = static_cast<uint32_t>(std::min(count - offset, InjectionReport::MaxEvents));
+        std::copy(events + offset, events + offset + report.count, report.events);
+        report.outputDevice = static_cast<uint16_t>(outputDevice);
+        report.captureUs = captureUs;
+        injectionQueue.push(report);
+    }
+}
+
+void EventManager::injectorLoop() {
+    auto deliver = [this](const InjectionReport &report) { injectReport(report); };
+    while (isInjecting) {
+        if (injectionQueue.drain(deliver) == 0) {
+            injectionQueue.wait(IdleWaitMs);
+        }
+    }
+
+    // Deliver whatever was queued before the stop request.
+    injectionQueue.drain(deliver);
+}
+
+void EventManager::stopInjector() {
+    isInjecting = false;
+    injectionQueue.wake();
+    if (injectorThread.joinable()) {
+        injectorThread.join();
+    }
+}
+
+void EventManager::injectReport(const InjectionReport &report) {
 #ifdef ENABLE_UINPUT
-    sendUInputEvent(keyType, keyCode);
+    sendUInputEvents(report.outputDevice, report.events, report.count);
 #else
-    sendLibUInputEvent(keyType, keyCode);
+    for (uint32_t i = 0; i < report.count; ++i) {
+        sendLibUInputEvent(report.events[i].keyType, report.events[i].keyCode);
+    }
 #endif
+
+    // Capture timestamps come from the monotonic clock, the same clock as steady_clock.
+    if (report.captureUs >= 0) {
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        mirrorLatency.add(std::chrono::duration_cast<std::chrono::microseconds>(now).count() - report.captureUs);
+    }
 }
 
-void EventManager::startRecording(const std::string &outputFile) {
+void EventManager::startRecording(const std::string &outputFile, const RecordOptions &options) {
     if (isRecording) {
         logWarn("Recording already in progress.");
         return;
     }
 
+    // The capture thread reads the options, so it is stopped before they change.
+    std::lock_guard<std::mutex> captureLock(captureMutex);
+    stopCapture();
     recordFilePath = outputFile;
-    recordedEvents.clear();
-    isRecording = true;
-
-#ifdef ENABLE_UINPUT
-    discoverInputDevices();
+    recordOptions = options;
 
-    isEvdevRecording = true;
-    evdevRecordingThread = std::thread(&EventManager::evdevRecordingLoop, this);
-#else
-    IARMUtils::registerIRKeyHandler([this](int keyType, int keyCode) { handleEvent(keyType, keyCode); });
+#ifndef ENABLE_UINPUT
+    if (options.rawEvents) {
+        logWarn("Raw capture requires evdev; only IR key events will be recorded.");
+        recordOptions.rawEvents = false;
+    }
+    // IR keys injected through libuinput reach the IR handler again, so they cannot be mirrored.
+    if (options.mirror) {
+        logError("Mirroring requires evdev capture; IR events would be injected back into the IR bus.");
+        recordOptions.mirror = false;
+    }
 #endif
+    {
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        mirrorLatency.reset();
+    }
+
+    if (!outputFile.empty()) {
+        recordWriter.start(outputFile, options.format);
+    } else if (!recordOptions.mirror) {
+        throw std::runtime_error("Nothing to do: no record file and no mirroring.");
+    }
+    isRecording = true;
+    startCapture();
 
-    logInfo("Started recording key events to: " + outputFile);
+    if (!outputFile.empty()) {
+        logInfo("Started recording key events to: " + outputFile);
+    }
+    if (recordOptions.mirror) {
+        logInfo("Mirroring captured key events to the output device.");
+    }
 }
 
 void EventManager::stopRecording() {
@@ -100,119 +196,337 @@ void EventManager::stopRecording() {
     }
 
     isRecording = false;
+    {
+        // Key listeners keep the capture running, on their own devices only.
+        std::lock_guard<std::mutex> lock(captureMutex);
+        if (hasKeyListeners) {
+            startCapture();
+        } else {
+            stopCapture();
+        }
+    }
+
+    recordWriter.stop();
+
+    if (recordOptions.mirror) {
+        std::lock_guard<std::mutex> lock(latencyMutex);
+        logInfo("Mirror latency (capture to injection): " + mirrorLatency.summary());
+    }
+    if (!recordFilePath.empty()) {
+        logInfo("Stopped recording. Events saved to: " + recordFilePath);
+    }
+}
+
+void EventManager::mirrorEvent(int keyType, int keyCode, int64_t timestampUs) {
+    auto remapped = recordOptions.mirrorKeyMap.find(keyCode);
+    KeyEvent event{keyType, remapped != recordOptions.mirrorKeyMap.end() ? remapped->second : keyCode};
+    enqueueEvents(&event, 1, 0, timestampUs);
+}
+
+size_t EventManager::addKeyListener(KeyListener listener) {
+    size_t listenerId;
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex);
+        listenerId = nextListenerId++;
+        keyListeners.emplace(listenerId, std::move(listener));
+        hasKeyListeners = true;
+    }
+
+    // A running recording captures the listeners' devices as well. hasKeyListeners is set
+    // first, so a capture thread that is about to end either sees it or is seen ending.
+    std::lock_guard<std::mutex> lock(captureMutex);
 #ifdef ENABLE_UINPUT
-    stopEvdevThread();
+    if (!isCapturing || hasCaptureEnded) {
+#else
+    if (!isCapturing) {
 #endif
+        startCapture();
+    }
+    return listenerId;
+}
+
+void EventManager::removeKeyListener(size_t listenerId) {
+    // The capture is left running; its thread ends once it has been idle for CaptureLingerMs.
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    keyListeners.erase(listenerId);
+    hasKeyListeners = !keyListeners.empty();
+}
 
-    writeRecordedEventsToFile();
+void EventManager::setListenDeviceFilter(const DeviceFilter &filter) { listenDeviceFilter = filter; }
 
-    logInfo("Stopped recording. Events saved to: " + recordFilePath);
+void EventManager::notifyKeyListeners(int keyType, int keyCode) {
+    if (!hasKeyListeners) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(listenerMutex);
+    for (const auto &[listenerId, listener] : keyListeners) {
+        listener(keyType, keyCode);
+    }
 }
 
-void EventManager::writeRecordedEventsToFile() {
+void EventManager::startCapture() {
+    stopCapture();
+
+#ifdef ENABLE_UINPUT
+    // The capture thread has been joined, so nothing reads the tables.
+    captureDevices.clear();
+    captureDeviceIds.clear();
+
+    // Never capture our own virtual device, or replayed keys would be recorded again.
+    std::string ownDevices = std::string("-name:") + UInputDeviceName + "*";
+    deviceFilter = recordOptions.deviceFilter;
+    deviceFilter.addRule(ownDevices);
+    listenFilter = listenDeviceFilter;
+    listenFilter.addRule(ownDevices);
+    discoverInputDevices();
+
+    hasCaptureEnded = false;
+    isEvdevRecording = true;
+    evdevRecordingThread = std::thread(&EventManager::evdevRecordingLoop, this);
+#else
+    if ((isRecording && !recordOptions.deviceFilter.empty()) || !listenDeviceFilter.empty()) {
+        logWarn("Device rules only apply to evdev capture and are ignored for IR events.");
+    }
+    // The IR handler stays registered and reads the tables on the IARM thread.
     std::lock_guard<std::mutex> lock(recordingMutex);
-    std::ofstream outFile(recordFilePath);
-    if (!outFile.is_open()) {
-        logError("Failed to open file for writing: " + recordFilePath);
+    captureDevices.clear();
+    captureDeviceIds.clear();
+    addCaptureDevice("ir", "ir", true, true);
+
+    // The handler cannot be removed individually, so it is registered once and stays.
+    if (!isIRHandlerRegistered) {
+        // IR key events carry no timestamp, so they are stamped on arrival.
+        IARMUtils::registerIRKeyHandler([this](int keyType, int keyCode) {
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            std::lock_guard<std::mutex> lock(recordingMutex);
+            handleEvent(IRDeviceId, keyType, keyCode,
+                        std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+        });
+        isIRHandlerRegistered = true;
+    }
+#endif
+    isCapturing = true;
+}
+
+void EventManager::stopCapture() {
+    if (!isCapturing) {
         return;
     }
+#ifdef ENABLE_UINPUT
+    stopEvdevThread();
+#endif
+    isCapturing = false;
+}
+
+uint16_t EventManager::addCaptureDevice(const std::string &path, const std::string &name, bool recorded,
+                                        bool listened, const CaptureDeviceCapabilities *capabilities) {
+    // A device that reconnects keeps its id, so its debounce state and recorded identity carry over.
+    std::string identity = path + '\n' + name;
+    auto known = captureDeviceIds.find(identity);
+    if (known != captureDeviceIds.end()) {
+        return known->second;
+    }
+
+    CaptureDeviceState state;
+    state.recorded = recorded;
+    state.listened = listened;
+    state.debounceMs = recordOptions.debounceMs;
 
-    for (const auto &event : recordedEvents) {
-        outFile << event << "\n";
+    auto it = recordOptions.deviceDebounceMs.find(path);
+    if (it == recordOptions.deviceDebounceMs.end()) {
+        it = recordOptions.deviceDebounceMs.find(name);
+    }
+    if (it != recordOptions.deviceDebounceMs.end()) {
+        state.debounceMs = it->second;
     }
 
-    outFile.close();
-    logInfo("Recorded events written to file: " + recordFilePath);
+    captureDevices.push_back(std::move(state));
+    auto deviceId = static_cast<uint16_t>(captureDevices.size() - 1);
+    captureDeviceIds[identity] = deviceId;
+    if (recorded) {
+        recordWriter.addDevice(deviceId, name.empty() ? path : name, capabilities);
+    }
+    logDebug("Capture device " + std::to_string(deviceId) + ": " + path + " (" + name +
+             "), debounce: " + std::to_string(captureDevices.back().debounceMs) + "ms");
+    return deviceId;
 }
 
-void EventManager::handleEvent(int keyType, int keyCode) {
-    if (!isRecording) {
-        logWarn("No recording in progress.");
+void EventManager::handleEvent(uint16_t deviceId, int keyType, int keyCode, int64_t timestampUs) {
+    if (isLogEnabled(LogLevel::TRACE)) {
+        logTrace("Received event: device=" + std::to_string(deviceId) + ", keyType=" + std::to_string(keyType) +
+                 ", keyCode=" + std::to_string(keyCode));
+    }
+
+    if (deviceId >= captureDevices.size()) {
+        return;
+    }
+    CaptureDeviceState &state = captureDevices[deviceId];
+    if (state.listened) {
+        notifyKeyListeners(keyType, keyCode);
+    }
+    if (!isRecording || !state.recorded) {
+        return;
+    }
+
+    // Debounce presses of the same key on the same device; the repeats and release belonging to
+    // a debounced press are dropped with it so the recorded sequence stays balanced.
+    if (state.debounceMs > 0) {
+        if (keyType == static_cast<int>(KET_KEYDOWN)) {
+            auto last = state.lastDownUs.find(keyCode);
+            if (last != state.lastDownUs.end() && timestampUs - last->second < state.debounceMs * 1000LL) {
+                logDebug("Debounced press: device=" + std::to_string(deviceId) +
+                         ", keyCode=" + std::to_string(keyCode));
+                state.suppressedKeys.insert(keyCode);
+                return;
+            }
+            state.lastDownUs[keyCode] = timestampUs;
+            state.suppressedKeys.erase(keyCode);
+        } else if (state.suppressedKeys.count(keyCode) != 0) {
+            if (keyType == static_cast<int>(KET_KEYUP)) {
+                state.suppressedKeys.erase(keyCode);
+            }
+            return;
+        }
+    }
+
+    if (recordOptions.mirror) {
+        mirrorEvent(keyType, keyCode, timestampUs);
+    }
+    if (recordFilePath.empty()) {
         return;
     }
 
-    // Log the received event
-    logDebug("Received event: keyType=" + std::to_string(keyType) + ", keyCode=" + std::to_string(keyCode));
+    InputRecord record{};
+    record.timestampUs = timestampUs;
+    record.deviceId = deviceId;
+    record.type = INPUT_TYPE_KEY;
+    record.code = static_cast<uint16_t>(keyCode);
+    record.value = keyType == static_cast<int>(KET_KEYDOWN)     ? INPUT_PRESS
+                   : keyType == static_cast<int>(KET_KEYREPEAT) ? INPUT_REPEAT
+                                                                : INPUT_RELEASE;
+
+    // Hand the event to the writer thread; pairing, formatting and file I/O happen there
+    if (!recordWriter.push(record)) {
+        logWarn("Record queue full, dropped key event: keyCode=" + std::to_string(keyCode));
+    }
+}
+
+#ifdef ENABLE_UINPUT
+static void readBits(int fd, int type, uint8_t *bits, size_t size) {
+    if (ioctl(fd, EVIOCGBIT(type, size), bits) < 0) {
+        memset(bits, 0, size);
+    }
+}
 
-    static thread_local int lastKeyType = -1;
-    static thread_local int lastKeyCode = -1;
-    static thread_local std::chrono::steady_clock::time_point lastTimestamp;
+/**
+ * Reads what an evdev device can report, for replaying its raw events on a virtual device.
+ */
+static CaptureDeviceCapabilities readCapabilities(int fd, uint32_t eventTypes) {
+    CaptureDeviceCapabilities capabilities{};
+    capabilities.eventTypes = eventTypes;
+
+    struct input_id id {};
+    if (ioctl(fd, EVIOCGID, &id) >= 0) {
+        capabilities.bustype = id.bustype;
+        capabilities.vendor = id.vendor;
+        capabilities.product = id.product;
+        capabilities.version = id.version;
+    }
 
-    auto now = std::chrono::steady_clock::now();
-    const int duplicateThresholdMs = 200;
+    readBits(fd, EV_KEY, capabilities.keyBits, sizeof(capabilities.keyBits));
+    readBits(fd, EV_REL, capabilities.relBits, sizeof(capabilities.relBits));
+    readBits(fd, EV_ABS, capabilities.absBits, sizeof(capabilities.absBits));
+    readBits(fd, EV_MSC, capabilities.mscBits, sizeof(capabilities.mscBits));
+    if (ioctl(fd, EVIOCGPROP(sizeof(capabilities.propBits)), capabilities.propBits) < 0) {
+        memset(capabilities.propBits, 0, sizeof(capabilities.propBits));
+    }
 
-    // Avoid duplicate key presses within the threshold
-    if (keyType == lastKeyType && keyCode == lastKeyCode) {
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastTimestamp).count();
-        if (elapsed < duplicateThresholdMs && keyType == KET_KEYDOWN) {
-            logDebug("Filtered duplicate event: keyCode=" + std::to_string(keyCode) +
-                     ", elapsed=" + std::to_string(elapsed) + "ms");
-            return;
+    for (size_t code = 0; code < CaptureDeviceCapabilities::AbsCount; ++code) {
+        struct input_absinfo absInfo {};
+        if ((capabilities.absBits[code / 8] & (1u << (code % 8))) && ioctl(fd, EVIOCGABS(code), &absInfo) >= 0) {
+            capabilities.absInfo[code] = {absInfo.minimum, absInfo.maximum, absInfo.fuzz, absInfo.flat,
+                                          absInfo.resolution};
         }
     }
+    return capabilities;
+}
 
-    lastKeyType = keyType;
-    lastKeyCode = keyCode;
-    lastTimestamp = now;
+int EventManager::openInputDevice(const std::string &devicePath) {
+    int fd = open(devicePath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        logWarn("Failed to open input device: " + devicePath);
+        return -1;
+    }
 
-    // Only process key down events
-    if (keyType != static_cast<int>(KET_KEYDOWN)) {
-        logDebug("Ignoring non-keydown event: keyType=" + std::to_string(keyType));
-        logDebug("Debug: keyType=" + std::to_string(keyType) + ", KET_KEYDOWN=" + std::to_string(KET_KEYDOWN));
-        return;
+    InputDeviceInfo info = InputDeviceInfo::probe(fd, devicePath);
+    bool recorded = isRecording && deviceFilter.matches(info);
+    bool listened = listenFilter.matches(info);
+    if (!recorded && !listened) {
+        logInfo("Skipping input device: " + devicePath + " (" + info.name + ")");
+        close(fd);
+        return -1;
     }
 
-    // Get the key name from the key code
-    std::string keyName = keyMap.getKeyName(keyCode);
-    if (keyName.empty()) {
-        logWarn("Unknown key code: " + std::to_string(keyCode));
-        keyName = "KEY_UNKNOWN_" + std::to_string(keyCode);
+    // Stamp events from the monotonic clock so wall-clock adjustments don't distort gaps
+    int clockId = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clockId) < 0) {
+        logDebug("Failed to select monotonic event clock for: " + devicePath);
     }
 
-    // Create the command string
-    std::string command = "key_press " + keyName;
+    CaptureDeviceCapabilities capabilities{};
+    bool raw = recorded && recordOptions.rawEvents;
+    if (raw) {
+        capabilities = readCapabilities(fd, info.eventTypes);
+    }
 
-    // Add the command to the recorded events
-    {
-        std::lock_guard<std::mutex> lock(recordingMutex);
-        recordedEvents.push_back(command);
+    std::lock_guard<std::mutex> lock(recordingMutex);
+    evdevDevices[fd] = {devicePath,
+                        addCaptureDevice(devicePath, info.name, recorded, listened, raw ? &capabilities : nullptr)};
+    logInfo("Discovered input device: " + devicePath + " (" + info.name + ")");
+    return fd;
+}
+
+bool EventManager::isInputDeviceOpen(const std::string &devicePath) {
+    std::lock_guard<std::mutex> lock(recordingMutex);
+    for (const auto &[fd, device] : evdevDevices) {
+        if (device.path == devicePath) {
+            return true;
+        }
     }
+    return false;
+}
 
-    logInfo("Recorded key event: " + command);
+void EventManager::closeInputDevice(int fd) {
+    std::lock_guard<std::mutex> lock(recordingMutex);
+    auto it = evdevDevices.find(fd);
+    if (it != evdevDevices.end()) {
+        logWarn("Input device disconnected: " + it->second.path + ". It will be re-added if it reconnects.");
+        evdevDevices.erase(it);
+    }
+    close(fd);
 }
 
-#ifdef ENABLE_UINPUT
 void EventManager::discoverInputDevices() {
-    std::map<int, std::string> tempDevices;
-
     DIR *dir = opendir("/dev/input");
     if (!dir) {
         logError("Failed to open /dev/input directory.");
         return;
     }
 
+    size_t discovered = 0;
     struct dirent *entry;
     while ((entry = readdir(dir)) != nullptr) {
         if (strncmp(entry->d_name, "event", 5) == 0) {
-            std::string devicePath = "/dev/input/" + std::string(entry->d_name);
-            int fd = open(devicePath.c_str(), O_RDONLY | O_NONBLOCK);
-            if (fd >= 0) {
-                tempDevices[fd] = devicePath;
-                logInfo("Discovered input device: " + devicePath);
-            } else {
-                logWarn("Failed to open input device: " + devicePath);
+            if (openInputDevice("/dev/input/" + std::string(entry->d_name)) >= 0) {
+                ++discovered;
             }
         }
     }
     closedir(dir);
 
-    if (tempDevices.empty()) {
-        logError("No usable input devices found in /dev/input.");
-        return;
+    if (discovered == 0) {
+        logWarn("No usable input devices found in /dev/input. Waiting for devices to be connected.");
     }
-
-    std::lock_guard<std::mutex> lock(recordingMutex);
-    evdevDevices = std::move(tempDevices);
 }
 
 void EventManager::stopEvdevThread() {
@@ -231,91 +545,213 @@ void EventManager::stopEvdevThread() {
     logInfo("Evdev recording thread terminated.");
 }
 
-void EventManager::evdevRecordingLoop() {
-    std::vector<struct pollfd> fds;
-    {
-        std::lock_guard<std::mutex> lock(recordingMutex);
-        for (const auto &[fd, device] : evdevDevices) {
-            logDebug("Adding device to poll set: " + device + " (fd: " + std::to_string(fd) + ")");
-            fds.push_back({fd, POLLIN, 0});
+bool EventManager::handleHotplug(int inotifyFd) {
+    alignas(struct inotify_event) char buffer[4096];
+    bool added = false;
+
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->len == 0 || strncmp(event->name, "event", 5) != 0) {
+                continue;
+            }
+
+            // udev fixes up permissions after creating the node, so IN_ATTRIB retries a failed open.
+            std::string devicePath = "/dev/input/" + std::string(event->name);
+            if (!isInputDeviceOpen(devicePath) && openInputDevice(devicePath) >= 0) {
+                added = true;
+            }
         }
     }
 
-    if (fds.empty()) {
-        logError("No input devices found for polling.");
-        return;
+    return added;
+}
+
+void EventManager::evdevRecordingLoop() {
+    int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, "/dev/input", IN_CREATE | IN_ATTRIB | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    if (inotifyFd < 0) {
+        logWarn("Failed to watch /dev/input: " + std::string(strerror(errno)) +
+                ". Devices connected during recording will not be captured.");
     }
 
-    struct input_event ev;
+    std::vector<struct pollfd> fds;
+    std::map<int, uint16_t> deviceIds;
+    bool devicesChanged = true;
+    struct input_event events[64];
+    auto lastNeeded = std::chrono::steady_clock::now();
 
     while (isEvdevRecording) {
-        logDebug("Polling for events...");
+        // Without listeners or a recording the capture lingers, then ends. hasCaptureEnded is
+        // published before the last check, so a listener added meanwhile either keeps the
+        // capture or sees it ended and restarts it.
+        auto now = std::chrono::steady_clock::now();
+        if (hasKeyListeners || isRecording) {
+            lastNeeded = now;
+        } else if (now - lastNeeded >= std::chrono::milliseconds(CaptureLingerMs)) {
+            hasCaptureEnded = true;
+            if (!hasKeyListeners && !isRecording) {
+                logDebug("Capture idle for " + std::to_string(CaptureLingerMs) + "ms, ending it.");
+                break;
+            }
+            hasCaptureEnded = false;
+            lastNeeded = now;
+        }
+
+        if (devicesChanged) {
+            fds.clear();
+            deviceIds.clear();
+            if (inotifyFd >= 0) {
+                fds.push_back({inotifyFd, POLLIN, 0});
+            }
+
+            std::lock_guard<std::mutex> lock(recordingMutex);
+            for (const auto &[fd, device] : evdevDevices) {
+                logDebug("Adding device to poll set: " + device.path + " (fd: " + std::to_string(fd) + ")");
+                fds.push_back({fd, POLLIN, 0});
+                deviceIds[fd] = device.id;
+            }
+            devicesChanged = false;
+        }
+
+        if (fds.empty()) {
+            logError("No input devices to poll and hotplug detection is unavailable.");
+            break;
+        }
+
         int pollResult = poll(fds.data(), fds.size(), 500);
 
         if (pollResult < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             logError("Poll failed during evdev recording: " + std::string(strerror(errno)));
             break;
         } else if (pollResult == 0) {
-            logDebug("Poll timed out. No events received.");
             continue;
         }
 
         for (auto &fdStruct : fds) {
-            if (fdStruct.revents & POLLIN) {
-                logDebug("Event ready on fd: " + std::to_string(fdStruct.fd));
+            if (fdStruct.fd == inotifyFd) {
+                if ((fdStruct.revents & POLLIN) && handleHotplug(inotifyFd)) {
+                    devicesChanged = true;
+                }
+                continue;
+            }
 
-                ssize_t bytesRead = read(fdStruct.fd, &ev, sizeof(ev));
+            if (fdStruct.revents & POLLIN) {
+                ssize_t bytesRead = read(fdStruct.fd, events, sizeof(events));
                 if (bytesRead < 0) {
-                    logError("Read failed on fd: " + std::to_string(fdStruct.fd) +
-                             ", error: " + std::string(strerror(errno)));
+                    if (errno == ENODEV) {
+                        closeInputDevice(fdStruct.fd);
+                        devicesChanged = true;
+                    } else if (errno != EAGAIN) {
+                        logError("Read failed on fd: " + std::to_string(fdStruct.fd) +
+                                 ", error: " + std::string(strerror(errno)));
+                    }
                     continue;
                 }
 
-                if (bytesRead != sizeof(ev)) {
-                    logWarn("Incomplete event read on fd: " + std::to_string(fdStruct.fd));
+                uint16_t deviceId = deviceIds[fdStruct.fd];
+                size_t count = static_cast<size_t>(bytesRead) / sizeof(struct input_event);
+                if (recordOptions.rawEvents) {
+                    handleRawEvents(deviceId, events, count);
                     continue;
                 }
-
-                logDebug("Event received: type=" + std::to_string(ev.type) + ", code=" + std::to_string(ev.code) +
-                         ", value=" + std::to_string(ev.value));
-
-                if (ev.type == EV_KEY) {
-                    logDebug("Key event: code=" + std::to_string(ev.code) + ", value=" + std::to_string(ev.value));
-                    handleEvent(ev.value, ev.code);
-                } else {
-                    logDebug("Non-key event ignored: type=" + std::to_string(ev.type));
+                for (size_t k = 0; k < count; ++k) {
+                    const struct input_event &ev = events[k];
+                    if (ev.type == EV_KEY) {
+                        handleEvent(deviceId, ev.value, ev.code,
+                                    static_cast<int64_t>(ev.time.tv_sec) * 1000000 + ev.time.tv_usec);
+                    }
                 }
-            } else if (fdStruct.revents & (POLLERR | POLLHUP)) {
-                logWarn("Device disconnected (fd: " + std::to_string(fdStruct.fd) + "). Removing from poll set.");
-                close(fdStruct.fd);
-                fdStruct.fd = -1;
+            } else if (fdStruct.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                closeInputDevice(fdStruct.fd);
+                devicesChanged = true;
             }
         }
+    }
 
-        // Remove invalid file descriptors from the poll set
-        auto oldSize = fds.size();
-        fds.erase(std::remove_if(fds.begin(), fds.end(), [](const pollfd &pfd) { return pfd.fd == -1; }), fds.end());
-
-        if (fds.size() != oldSize) {
-            logInfo("Removed disconnected devices. Remaining devices: " + std::to_string(fds.size()));
-        }
+    // Whether stopped, idle or failed, the next listener has to start the capture again.
+    hasCaptureEnded = true;
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
     }
 
     logInfo("Evdev recording loop terminated.");
 }
 
+void EventManager::handleRawEvents(uint16_t deviceId, const struct input_event *events, size_t count) {
+    // Raw streams can run at thousands of events per second, so they bypass debouncing and
+    // per-event logging; records that do not fit in the queue are counted by the writer.
+    const CaptureDeviceState &state = captureDevices[deviceId];
+    for (size_t k = 0; k < count; ++k) {
+        InputRecord record{};
+        record.timestampUs = static_cast<int64_t>(events[k].time.tv_sec) * 1000000 + events[k].time.tv_usec;
+        record.deviceId = deviceId;
+        record.type = events[k].type;
+        record.code = events[k].code;
+        record.value = events[k].value;
+
+        if (record.type == EV_KEY && state.listened) {
+            notifyKeyListeners(record.value, record.code);
+        }
+        if (!isRecording || !state.recorded) {
+            continue;
+        }
+        if (recordOptions.mirror && record.type == EV_KEY) {
+            mirrorEvent(record.value, record.code, record.timestampUs);
+        }
+        if (!recordFilePath.empty()) {
+            recordWriter.push(record);
+        }
+    }
+}
+
 void EventManager::setupUInput() {
-    uinputFd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
-    if (uinputFd < 0) {
+    // Additional devices get numbered names that keep the common prefix, so none of them is
+    // ever captured.
+    for (size_t device = 0; device < outputDeviceCount; ++device) {
+        std::string name = UInputDeviceName;
+        if (device > 0) {
+            name += "-" + std::to_string(device + 1);
+        }
+        try {
+            uinputFds.push_back(createUInputDevice(name, static_cast<uint16_t>(device)));
+        } catch (const std::exception &) {
+            cleanupUInput();
+            throw;
+        }
+    }
+
+    logInfo("UInput setup completed with " + std::to_string(uinputFds.size()) + " device(s).");
+}
+
+int EventManager::createUInputDevice(const std::string &name, uint16_t index) {
+    int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+    if (fd < 0) {
         throw std::runtime_error("Failed to open /dev/uinput");
     }
 
-    ioctl(uinputFd, UI_SET_EVBIT, EV_KEY);
-    ioctl(uinputFd, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd, UI_SET_EVBIT, EV_MSC);
+    ioctl(fd, UI_SET_MSCBIT, MSC_SCAN);
 
-    for (int i = 0; i < 256; ++i) {
-        if (ioctl(uinputFd, UI_SET_KEYBIT, i) < 0) {
-            close(uinputFd); // Ensure immediate cleanup
+    // Enable every keyboard and remote key. Button ranges are left out, since mouse, joystick
+    // and touch buttons would make input stacks treat the device as a pointer or gamepad.
+    for (int i = 1; i < KEY_CNT; ++i) {
+        if ((i >= BTN_MISC && i < KEY_OK) || (i >= BTN_TRIGGER_HAPPY && i <= BTN_TRIGGER_HAPPY40)) {
+            continue;
+        }
+        if (ioctl(fd, UI_SET_KEYBIT, i) < 0) {
+            close(fd); // Ensure immediate cleanup
             throw std::runtime_error("Failed to configure key bit for uinput");
         }
     }
@@ -323,61 +759,59 @@ void EventManager::setupUInput() {
     struct uinput_setup setup {};
     setup.id.bustype = BUS_USB;
     setup.id.vendor = 0x1234;
-    setup.id.product = 0x5678;
-    strncpy(setup.name, "OttoUInput", sizeof(setup.name) - 1);
+    setup.id.product = static_cast<uint16_t>(0x5678 + index);
+    strncpy(setup.name, name.c_str(), sizeof(setup.name) - 1);
     setup.name[sizeof(setup.name) - 1] = '\0';
 
-    if (ioctl(uinputFd, UI_DEV_SETUP, &setup) < 0 || ioctl(uinputFd, UI_DEV_CREATE) < 0) {
-        close(uinputFd);
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        close(fd);
         throw std::runtime_error("Failed to setup uinput device");
     }
 
-    logInfo("UInput setup completed.");
+    logDebug("Created uinput device: " + name);
+    return fd;
 }
 
 void EventManager::cleanupUInput() {
-    if (uinputFd >= 0) {
-        ioctl(uinputFd, UI_DEV_DESTROY);
-        close(uinputFd);
-        uinputFd = -1;
+    for (int fd : uinputFds) {
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+    if (!uinputFds.empty()) {
+        uinputFds.clear();
         logInfo("UInput device cleaned up.");
     }
 }
 
-void EventManager::sendUInputEvent(int keyType, int keyCode) {
-    struct input_event ev;
-
-    // MSC_SCAN: Send the scancode of the key
-    memset(&ev, 0, sizeof(ev));
-    ev.type = EV_MSC;
-    ev.code = MSC_SCAN;
-    ev.value = keyCode; // Use the key code as the scan code
-    if (write(uinputFd, &ev, sizeof(ev)) < 0) {
-        logError("Failed to send MSC_SCAN event.");
-        return;
+void EventManager::sendUInputEvents(size_t outputDevice, const KeyEvent *events, size_t count) {
+    // Each key gets its MSC_SCAN and EV_KEY pair, and one SYN_REPORT closes the whole report,
+    // which is handed to the kernel in a single write.
+    std::vector<struct input_event> report(2 * count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        struct input_event &scan = report[2 * i];
+        scan.type = EV_MSC;
+        scan.code = MSC_SCAN;
+        scan.value = events[i].keyCode; // Use the key code as the scan code
+
+        struct input_event &key = report[2 * i + 1];
+        key.type = EV_KEY;
+        key.code = static_cast<uint16_t>(events[i].keyCode);
+        key.value = (events[i].keyType == KET_KEYDOWN) ? 1 : (events[i].keyType == KET_KEYREPEAT) ? 2 : 0;
     }
+    report.back().type = EV_SYN;
+    report.back().code = SYN_REPORT;
 
-    // EV_KEY: Send the key press or release event
-    memset(&ev, 0, sizeof(ev));
-    ev.type = EV_KEY;
-    ev.code = keyCode;
-    ev.value = (keyType == KET_KEYDOWN) ? 1 : 0;
-    if (write(uinputFd, &ev, sizeof(ev)) < 0) {
-        logError("Failed to send EV_KEY event.");
+    size_t size = report.size() * sizeof(struct input_event);
+    int fd = uinputFds[outputDevice < uinputFds.size() ? outputDevice : 0];
+    if (write(fd, report.data(), size) != static_cast<ssize_t>(size)) {
+        logError("Failed to send key event report: " + std::string(strerror(errno)));
         return;
     }
 
-    // EV_SYN: Synchronize the event
-    memset(&ev, 0, sizeof(ev));
-    ev.type = EV_SYN;
-    ev.code = SYN_REPORT;
-    ev.value = 0;
-    if (write(uinputFd, &ev, sizeof(ev)) < 0) {
-        logError("Failed to send SYN_REPORT event.");
-        return;
+    for (size_t i = 0; i < count && isLogEnabled(LogLevel::DEBUG); ++i) {
+        logDebug("Event sent: KeyCode = " + std::to_string(events[i].keyCode) +
+                 ", KeyType = " + std::to_string(events[i].keyType));
     }
-
-    logDebug("Event sent: KeyCode = " + std::to_string(keyCode) + ", KeyType = " + std::to_string(keyType));
 }
 #else
 void EventManager::sendLibUInputEvent(int keyType, int keyCode) { IARMUtils::sendKeyEvent(keyType, keyCode); }
@@ -0,0 +1,114 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FileWatcher.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+// Editors either rewrite a file in place or write a new one and rename it over the old one.
+constexpr uint32_t DirectoryMask = IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+} // namespace
+
+FileWatcher::FileWatcher() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        throw std::runtime_error("Failed to initialize inotify for watching files: " + std::string(strerror(errno)));
+    }
+}
+
+FileWatcher::~FileWatcher() { close(inotifyFd); }
+
+void FileWatcher::watch(const std::vector<std::string> &files) {
+    std::map<int, std::string> newDirectories;
+    std::set<std::pair<int, std::string>> newWatched;
+
+    for (const auto &file : files) {
+        size_t slash = file.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : file.substr(0, slash));
+        std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+
+        // The same directory always yields the same wd, so watching it again keeps its events.
+        int wd = inotify_add_watch(inotifyFd, directory.c_str(), DirectoryMask);
+        if (wd < 0) {
+            throw std::runtime_error("Failed to watch directory " + directory + ": " + std::string(strerror(errno)));
+        }
+        newDirectories[wd] = directory;
+        newWatched.emplace(wd, name);
+    }
+
+    for (const auto &entry : directories) {
+        if (newDirectories.find(entry.first) == newDirectories.end()) {
+            inotify_rm_watch(inotifyFd, entry.first);
+        }
+    }
+    directories.swap(newDirectories);
+    watched.swap(newWatched);
+}
+
+std::string FileWatcher::waitForChange(const std::atomic<bool> &stop) {
+    std::string changed;
+    while (changed.empty()) {
+        if (stop) {
+            return changed;
+        }
+        changed = readChanges(StopCheckMs);
+    }
+    // The rest of the save, and any file saved with it
+    while (!readChanges(SettleMs).empty()) {
+    }
+    return changed;
+}
+
+std::string FileWatcher::readChanges(int timeoutMs) {
+    struct pollfd fd = {inotifyFd, POLLIN, 0};
+    int ready = poll(&fd, 1, timeoutMs);
+    if (ready < 0 && errno != EINTR) {
+        throw std::runtime_error("Poll failed while watching files: " + std::string(strerror(errno)));
+    }
+    if (ready <= 0) {
+        return std::string();
+    }
+
+    std::string changed;
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->len == 0 || !changed.empty() || watched.count({event->wd, event->name}) == 0) {
+                continue;
+            }
+            changed = directories[event->wd] + "/" + event->name;
+            logDebug("Watched file changed: " + changed);
+        }
+    }
+    if (length < 0 && errno != EAGAIN && errno != EINTR) {
+        throw std::runtime_error("Failed to read file change events: " + std::string(strerror(errno)));
+    }
+    return changed;
+}
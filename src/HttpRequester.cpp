@@ -0,0 +1,125 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpRequester.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+HttpRequester::~HttpRequester() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        if (currentPid > 0) {
+            kill(currentPid, SIGTERM);
+        }
+    }
+    requestCondition.notify_all();
+    if (requestThread.joinable()) {
+        requestThread.join();
+    }
+}
+
+HttpRequester &HttpRequester::getInstance() {
+    static HttpRequester instance;
+    return instance;
+}
+
+size_t HttpRequester::post(const std::string &url, CompletionListener listener) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!requestThread.joinable()) {
+        requestThread = std::thread(&HttpRequester::requestLoop, this);
+    }
+    size_t requestId = nextRequestId++;
+    requests.push_back({requestId, url, std::move(listener)});
+    requestCondition.notify_one();
+    return requestId;
+}
+
+void HttpRequester::cancel(size_t requestId) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.id == requestId) {
+        current.listener = nullptr;
+        return;
+    }
+    for (auto it = requests.begin(); it != requests.end(); ++it) {
+        if (it->id == requestId) {
+            requests.erase(it);
+            return;
+        }
+    }
+}
+
+void HttpRequester::requestLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        requestCondition.wait(lock, [this]() { return stopping || !requests.empty(); });
+        if (stopping) {
+            return;
+        }
+        current = std::move(requests.front());
+        requests.pop_front();
+        std::string url = current.url;
+
+        lock.unlock();
+        int status = send(url);
+        lock.lock();
+
+        // Called with the mutex held, so cancel() cannot return while the listener runs.
+        if (current.listener) {
+            current.listener(status);
+        }
+        current = Request();
+    }
+}
+
+int HttpRequester::send(const std::string &url) {
+    const char *argv[] = {"curl", url.c_str(), "-X", "POST", "--data", " ", nullptr};
+    pid_t pid;
+    {
+        // Spawned with the mutex held, so the destructor either sees the process or stops it
+        // from being started.
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+            return -1;
+        }
+        int error = posix_spawnp(&pid, "curl", nullptr, nullptr, const_cast<char *const *>(argv), environ);
+        if (error != 0) {
+            logError("Failed to run curl: " + std::string(strerror(error)));
+            return -1;
+        }
+        currentPid = pid;
+    }
+
+    int status = 0;
+    pid_t result;
+    do {
+        result = waitpid(pid, &status, 0);
+    } while (result < 0 && errno == EINTR);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    currentPid = -1;
+    return result == pid && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
@@ -0,0 +1,84 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InjectionQueue.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+InjectionQueue::InjectionQueue() {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        throw std::runtime_error("Failed to create injection wake-up eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+InjectionQueue::~InjectionQueue() { close(wakeFd); }
+
+void InjectionQueue::push(const InjectionReport &report) {
+    auto &lane = lanes[report.outputDevice % lanes.size()];
+    while (!lane.tryPush(report)) {
+        wake();
+        std::this_thread::yield();
+    }
+
+    // Pairs with the consumer publishing consumerSleeping before its last emptiness check, so
+    // either the consumer sees this report or this producer sees the consumer asleep.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumerSleeping.load(std::memory_order_relaxed)) {
+        wake();
+    }
+}
+
+void InjectionQueue::wait(int timeoutMs) {
+    consumerSleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (isEmpty()) {
+        struct pollfd pfd = {wakeFd, POLLIN, 0};
+        if (poll(&pfd, 1, timeoutMs) > 0) {
+            uint64_t value;
+            ssize_t ignored = read(wakeFd, &value, sizeof(value));
+            (void)ignored;
+        }
+    }
+
+    consumerSleeping.store(false, std::memory_order_relaxed);
+}
+
+void InjectionQueue::wake() {
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+bool InjectionQueue::isEmpty() const {
+    for (const auto &lane : lanes) {
+        if (!lane.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
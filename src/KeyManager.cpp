@@ -1,31 +1,69 @@
 #include "KeyManager.h"
+#include "CaptureFile.h"
 #include "EventManager.h"
 #include "Logger.h"
+#include "ScriptEncoder.h"
 
+#ifdef ENABLE_UINPUT
+#include "VirtualInputDevice.h"
+#endif
+
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <fstream>
+#include <map>
+#include <stdexcept>
 #include <thread>
 
-KeyManager::KeyManager(int intervalMs) : intervalMs(intervalMs), keyMap() {}
+/**
+ * Symbols typed with the US keyboard layout, by their Linux key names.
+ */
+static const struct {
+    char symbol;
+    const char *keyName;
+    bool shift;
+} TextSymbols[] = {
+    {' ', "KEY_SPACE", false},        {'-', "KEY_MINUS", false},        {'=', "KEY_EQUAL", false},
+    {'[', "KEY_LEFTBRACE", false},    {']', "KEY_RIGHTBRACE", false},   {';', "KEY_SEMICOLON", false},
+    {'\'', "KEY_APOSTROPHE", false},  {'`', "KEY_GRAVE", false},        {'\\', "KEY_BACKSLASH", false},
+    {',', "KEY_COMMA", false},        {'.', "KEY_DOT", false},          {'/', "KEY_SLASH", false},
+    {'!', "KEY_1", true},             {'@', "KEY_2", true},             {'#', "KEY_3", true},
+    {'$', "KEY_4", true},             {'%', "KEY_5", true},             {'^', "KEY_6", true},
+    {'&', "KEY_7", true},             {'*', "KEY_8", true},             {'(', "KEY_9", true},
+    {')', "KEY_0", true},             {'_', "KEY_MINUS", true},         {'+', "KEY_EQUAL", true},
+    {'{', "KEY_LEFTBRACE", true},     {'}', "KEY_RIGHTBRACE", true},    {':', "KEY_SEMICOLON", true},
+    {'"', "KEY_APOSTROPHE", true},    {'~', "KEY_GRAVE", true},         {'|', "KEY_BACKSLASH", true},
+    {'<', "KEY_COMMA", true},         {'>', "KEY_DOT", true},           {'?', "KEY_SLASH", true}};
+
+KeyManager::KeyManager(int intervalMs, size_t outputDevice)
+    : intervalMs(intervalMs), outputDevice(outputDevice), keyMap() {}
 
 KeyManager::~KeyManager() {
+    // Never leave keys stuck down on the device when a script ends without key_up.
+    if (!heldKeys.empty()) {
+        logWarn("Releasing " + std::to_string(heldKeys.size()) + " key(s) still held at exit.");
+        sendEvents(KET_KEYUP, std::vector<int>(heldKeys.rbegin(), heldKeys.rend()));
+    }
     stopRecording();
     logDebug("Terminating KeyManager...");
 }
 
-void KeyManager::sendKeyPress(const std::string &key, int repeat) {
+void KeyManager::sendKeyPress(Timeline &timeline, const std::string &key, int repeat) {
     int keyCode = keyMap.getKeyCode(key);
     if (keyCode == -1) {
         logError("Invalid key: " + key);
         return;
     }
 
+    auto due = timeline.now();
     for (int i = 0; i < repeat; ++i) {
-        sendEvent(KET_KEYDOWN, keyCode);
-        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
-        sendEvent(KET_KEYUP, keyCode);
+        timeline.schedule(due, outputDevice, {{KET_KEYDOWN, keyCode}});
+        due += std::chrono::milliseconds(intervalMs);
+        timeline.schedule(due, outputDevice, {{KET_KEYUP, keyCode}});
     }
 
-    logDebug("Sent key press: " + key + " (repeat: " + std::to_string(repeat) +
+    logDebug("Scheduled key press: " + key + " (repeat: " + std::to_string(repeat) +
              ", interval: " + std::to_string(intervalMs) + "ms)");
 }
 
@@ -40,24 +78,334 @@ void KeyManager::sendKeyRelease(const std::string &key) {
     logDebug("Sent key release: " + key);
 }
 
-void KeyManager::sendKeyHold(const std::string &key, int durationMs) {
+void KeyManager::sendKeyHold(Timeline &timeline, const std::string &key, int durationMs, int repeatDelayMs,
+                             int repeatPeriodMs) {
     int keyCode = keyMap.getKeyCode(key);
     if (keyCode == -1) {
         logError("Invalid key: " + key);
         return;
     }
 
-    sendEvent(KET_KEYDOWN, keyCode);
-    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
-    sendEvent(KET_KEYUP, keyCode);
+    auto start = timeline.now();
+    auto release = start + std::chrono::milliseconds(durationMs);
+    int repeats = 0;
+
+    timeline.schedule(start, outputDevice, {{KET_KEYDOWN, keyCode}});
+    if (repeatDelayMs >= 0 && repeatPeriodMs > 0) {
+        auto period = std::chrono::milliseconds(repeatPeriodMs);
+        for (auto next = start + std::chrono::milliseconds(repeatDelayMs); next < release; next += period) {
+            timeline.schedule(next, outputDevice, {{KET_KEYREPEAT, keyCode}});
+            ++repeats;
+        }
+    }
+    timeline.schedule(release, outputDevice, {{KET_KEYUP, keyCode}});
+
+    logDebug("Scheduled key hold: " + key + " (duration: " + std::to_string(durationMs) +
+             "ms, repeats: " + std::to_string(repeats) + ")");
+}
+
+void KeyManager::sendKeyDown(Timeline &timeline, const std::vector<std::string> &keys) {
+    std::vector<int> keyCodes;
+    if (!resolveKeys(keys, keyCodes)) {
+        return;
+    }
+
+    scheduleEvents(timeline, timeline.now(), KET_KEYDOWN, keyCodes);
+    for (int keyCode : keyCodes) {
+        if (std::find(heldKeys.begin(), heldKeys.end(), keyCode) == heldKeys.end()) {
+            heldKeys.push_back(keyCode);
+        }
+    }
+    logDebug("Scheduled key down: " + std::to_string(keyCodes.size()) + " key(s)");
+}
+
+void KeyManager::sendKeyUp(Timeline &timeline, const std::vector<std::string> &keys) {
+    std::vector<int> keyCodes;
+    if (!resolveKeys(keys, keyCodes)) {
+        return;
+    }
+
+    scheduleEvents(timeline, timeline.now(), KET_KEYUP, keyCodes);
+    for (int keyCode : keyCodes) {
+        heldKeys.erase(std::remove(heldKeys.begin(), heldKeys.end(), keyCode), heldKeys.end());
+    }
+    logDebug("Scheduled key up: " + std::to_string(keyCodes.size()) + " key(s)");
+}
+
+bool KeyManager::releaseHeldKeys(Timeline &timeline) {
+    if (heldKeys.empty()) {
+        return false;
+    }
 
-    logDebug("Sent key hold: " + key + " (duration: " + std::to_string(durationMs) + "ms)");
+    logWarn("Releasing " + std::to_string(heldKeys.size()) + " key(s) still held at exit.");
+    scheduleEvents(timeline, timeline.now(), KET_KEYUP, std::vector<int>(heldKeys.rbegin(), heldKeys.rend()));
+    heldKeys.clear();
+    return true;
 }
 
-void KeyManager::sendEvent(int keyType, int keyCode) { EventManager::getInstance().sendEvent(keyType, keyCode); }
+const std::vector<int> &KeyManager::getHeldKeys() const { return heldKeys; }
 
-void KeyManager::startRecording(const std::string &outputFile) {
-    EventManager::getInstance().startRecording(outputFile);
+void KeyManager::pressHeldKeys(Timeline &timeline, const std::vector<int> &keyCodes) {
+    if (keyCodes.empty()) {
+        return;
+    }
+
+    scheduleEvents(timeline, timeline.now(), KET_KEYDOWN, keyCodes);
+    for (int keyCode : keyCodes) {
+        if (std::find(heldKeys.begin(), heldKeys.end(), keyCode) == heldKeys.end()) {
+            heldKeys.push_back(keyCode);
+        }
+    }
+}
+
+void KeyManager::sendKeyCombo(Timeline &timeline, const std::vector<std::string> &keys, int holdMs) {
+    std::vector<int> keyCodes;
+    if (!resolveKeys(keys, keyCodes)) {
+        return;
+    }
+
+    auto start = timeline.now();
+    scheduleEvents(timeline, start, KET_KEYDOWN, keyCodes);
+    std::reverse(keyCodes.begin(), keyCodes.end());
+    scheduleEvents(timeline, start + std::chrono::milliseconds(holdMs < 0 ? intervalMs : holdMs), KET_KEYUP,
+                   keyCodes);
+
+    logDebug("Scheduled key combo: " + std::to_string(keyCodes.size()) + " key(s)");
+}
+
+void KeyManager::typeText(Timeline &timeline, const std::string &text, int charIntervalMs) {
+    auto it = textSequences.find(text);
+    if (it == textSequences.end()) {
+        std::vector<TextKey> sequence;
+        if (!buildTextSequence(text, sequence)) {
+            return;
+        }
+        it = textSequences.emplace(text, std::move(sequence)).first;
+    }
+
+    // Characters are paced on absolute deadlines, so the time spent sending does not add up.
+    auto period = std::chrono::milliseconds(charIntervalMs < 0 ? intervalMs : charIntervalMs);
+    auto deadline = timeline.now();
+    std::vector<KeyEvent> events;
+    for (const TextKey &key : it->second) {
+        events.clear();
+        if (key.shift) {
+            events.push_back({KET_KEYDOWN, shiftKeyCode});
+        }
+        events.push_back({KET_KEYDOWN, key.keyCode});
+        timeline.schedule(deadline, outputDevice, events);
+
+        for (auto &event : events) {
+            event.keyType = KET_KEYUP;
+        }
+        std::reverse(events.begin(), events.end());
+        timeline.schedule(deadline + period / 2, outputDevice, events);
+
+        deadline += period;
+    }
+
+    logDebug("Scheduled text of " + std::to_string(text.size()) + " characters (interval: " +
+             std::to_string(period.count()) + "ms)");
+}
+
+bool KeyManager::buildTextSequence(const std::string &text, std::vector<TextKey> &sequence) {
+    sequence.reserve(text.size());
+    for (char c : text) {
+        bool shift = false;
+        int keyCode = findTextKey(c, shift);
+        if (keyCode < 0) {
+            logError("No key types the character '" + std::string(1, c) + "' in text: " + text);
+            return false;
+        }
+
+        if (shift && shiftKeyCode < 0) {
+            shiftKeyCode = keyMap.findKeyCode("shift");
+            if (shiftKeyCode < 0) {
+                shiftKeyCode = keyMap.findKeyCode("KEY_LEFTSHIFT");
+            }
+            if (shiftKeyCode < 0) {
+                logError("No shift key in the key map to type the character '" + std::string(1, c) + "'.");
+                return false;
+            }
+        }
+        sequence.push_back({keyCode, shift});
+    }
+    return true;
 }
 
-void KeyManager::stopRecording() { EventManager::getInstance().stopRecording(); }
+int KeyManager::findTextKey(char c, bool &shift) const {
+    // A key named after the character itself wins, e.g. the digit keys of a remote.
+    int keyCode = keyMap.findKeyCode(std::string(1, c));
+    if (keyCode >= 0) {
+        shift = false;
+        return keyCode;
+    }
+
+    if (std::isalpha(static_cast<unsigned char>(c))) {
+        shift = std::isupper(static_cast<unsigned char>(c));
+        return keyMap.findKeyCode(std::string("KEY_") + static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    }
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+        shift = false;
+        return keyMap.findKeyCode(std::string("KEY_") + c);
+    }
+    for (const auto &symbol : TextSymbols) {
+        if (symbol.symbol == c) {
+            shift = symbol.shift;
+            return keyMap.findKeyCode(symbol.keyName);
+        }
+    }
+    return -1;
+}
+
+bool KeyManager::resolveKeys(const std::vector<std::string> &keys, std::vector<int> &keyCodes) const {
+    keyCodes.clear();
+    keyCodes.reserve(keys.size());
+    for (const auto &key : keys) {
+        int keyCode = keyMap.getKeyCode(key);
+        if (keyCode == -1) {
+            logError("Invalid key: " + key);
+            return false;
+        }
+        keyCodes.push_back(keyCode);
+    }
+    return true;
+}
+
+void KeyManager::sendEvent(int keyType, int keyCode) {
+    EventManager::getInstance().sendEvent(keyType, keyCode, outputDevice);
+}
+
+void KeyManager::sendEvents(int keyType, const std::vector<int> &keyCodes) {
+    std::vector<KeyEvent> events;
+    events.reserve(keyCodes.size());
+    for (int keyCode : keyCodes) {
+        events.push_back({keyType, keyCode});
+    }
+    EventManager::getInstance().sendEvents(events, outputDevice);
+}
+
+void KeyManager::scheduleEvents(Timeline &timeline, Timeline::Clock::time_point due, int keyType,
+                                const std::vector<int> &keyCodes) {
+    std::vector<KeyEvent> events;
+    events.reserve(keyCodes.size());
+    for (int keyCode : keyCodes) {
+        events.push_back({keyType, keyCode});
+    }
+    timeline.schedule(due, outputDevice, std::move(events));
+}
+
+void KeyManager::startRecording(const std::string &outputFile, const RecordOptions &options) {
+    EventManager::getInstance().startRecording(outputFile, options);
+    isRecording = true;
+}
+
+void KeyManager::stopRecording() {
+    // Avoid bringing up the input backend just to stop a recording that never started,
+    // e.g. when only converting a capture file.
+    if (!isRecording) {
+        return;
+    }
+    EventManager::getInstance().stopRecording();
+    isRecording = false;
+}
+
+void KeyManager::replayCapture(const std::string &captureFile, double speed) {
+    CaptureFile capture(captureFile);
+
+    size_t index = 0;
+    size_t replayed = 0;
+    int64_t firstUs = -1;
+    auto start = std::chrono::steady_clock::now();
+
+#ifdef ENABLE_UINPUT
+    // Devices of a raw capture are replayed on virtual devices with their own capabilities.
+    std::map<uint16_t, std::unique_ptr<VirtualInputDevice>> rawDevices;
+    auto rawDeviceFor = [&](uint16_t deviceId) -> VirtualInputDevice * {
+        auto it = rawDevices.find(deviceId);
+        if (it != rawDevices.end()) {
+            return it->second.get();
+        }
+
+        const auto &capabilities = capture.getDeviceCapabilities();
+        auto found = capabilities.find(deviceId);
+        if (found == capabilities.end()) {
+            return nullptr;
+        }
+        auto name = capture.getDeviceNames().find(deviceId);
+        auto &device = rawDevices[deviceId];
+        device = std::make_unique<VirtualInputDevice>(
+            name != capture.getDeviceNames().end() ? name->second : "device " + std::to_string(deviceId),
+            found->second);
+        return device.get();
+    };
+#endif
+
+    while (const InputRecord *record = capture.next(index)) {
+        if (firstUs < 0) {
+#ifdef ENABLE_UINPUT
+            // Create the devices described up front and let their readers attach before replaying.
+            for (const auto &[deviceId, capabilities] : capture.getDeviceCapabilities()) {
+                rawDeviceFor(deviceId);
+            }
+            if (!rawDevices.empty()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(DeviceSettleMs));
+            }
+#endif
+            firstUs = record->timestampUs;
+            start = std::chrono::steady_clock::now();
+        }
+        auto offset = std::chrono::microseconds(static_cast<long long>((record->timestampUs - firstUs) / speed));
+
+#ifdef ENABLE_UINPUT
+        if (VirtualInputDevice *device = rawDeviceFor(record->deviceId)) {
+            if (device->append(*record)) {
+                std::this_thread::sleep_until(start + offset);
+                device->writeFrame();
+            }
+            ++replayed;
+            continue;
+        }
+#endif
+
+        if (record->type != INPUT_TYPE_KEY) {
+            continue;
+        }
+
+        std::this_thread::sleep_until(start + offset);
+
+        int keyType = record->value == INPUT_PRESS    ? KET_KEYDOWN
+                      : record->value == INPUT_REPEAT ? KET_KEYREPEAT
+                                                      : KET_KEYUP;
+        sendEvent(keyType, record->code);
+        ++replayed;
+    }
+
+    logInfo("Replayed " + std::to_string(replayed) + " events from capture file: " + captureFile);
+}
+
+void KeyManager::convertCapture(const std::string &captureFile, const std::string &outputFile) {
+    CaptureFile capture(captureFile);
+
+    std::ofstream outFile(outputFile);
+    if (!outFile.is_open()) {
+        logError("Failed to open file for writing: " + outputFile);
+        throw std::runtime_error("Could not open output file.");
+    }
+
+    ScriptEncoder encoder(keyMap);
+    std::string text = encoder.header();
+
+    size_t index = 0;
+    while (const InputRecord *record = capture.next(index)) {
+        encoder.encode(*record, text);
+        if (text.size() >= 64 * 1024) {
+            outFile << text;
+            text.clear();
+        }
+    }
+    encoder.finish(text);
+    outFile << text;
+
+    logInfo("Converted capture file " + captureFile + " to commands file: " + outputFile);
+}
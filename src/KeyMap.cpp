@@ -18,45 +18,105 @@
  */
 
 #include "KeyMap.h"
+#include "KeyProfile.h"
+#include "KeyTable.h"
 #include "Logger.h"
 
-KeyMap::KeyMap() { loadDefaultMappings(); }
+#ifdef HAVE_LINUX_KEY_CODES
+#include "LinuxKeyCodes.h"
+#endif
 
-void KeyMap::loadDefaultMappings() {
-    keyMappings = {
-        {"0", KEY_DIGIT0},       {"1", KEY_DIGIT1},           {"2", KEY_DIGIT2},      {"3", KEY_DIGIT3},
-        {"4", KEY_DIGIT4},       {"5", KEY_DIGIT5},           {"6", KEY_DIGIT6},      {"7", KEY_DIGIT7},
-        {"8", KEY_DIGIT8},       {"9", KEY_DIGIT9},           {"up", KEY_ARROWUP},    {"down", KEY_ARROWDOWN},
-        {"left", KEY_ARROWLEFT}, {"right", KEY_ARROWRIGHT},   {"enter", KEY_SELECT},  {"mute", KEY_MUTE},
-        {"volup", KEY_VOLUMEUP}, {"voldown", KEY_VOLUMEDOWN}, {"play", KEY_PLAY},     {"pause", KEY_PAUSE},
-        {"stop", KEY_STOP},      {"exit", KEY_EXIT},          {"info", KEY_INFO},     {"red", KEY_C},
-        {"green", KEY_D},        {"yellow", KEY_A},           {"blue", KEY_B},        {"power", KEY_POWER},
-        {"home", KEY_GUIDE},     {"settings", KEY_HELP},      {"record", KEY_RECORD}, {"input", KEY_INPUTKEY}};
+#include <iterator>
+#include <memory>
 
-    logDebug("Default key mappings loaded.");
+static constexpr KeyEntry DefaultKeyEntries[] = {
+    {"0", KEY_DIGIT0},       {"1", KEY_DIGIT1},           {"2", KEY_DIGIT2},      {"3", KEY_DIGIT3},
+    {"4", KEY_DIGIT4},       {"5", KEY_DIGIT5},           {"6", KEY_DIGIT6},      {"7", KEY_DIGIT7},
+    {"8", KEY_DIGIT8},       {"9", KEY_DIGIT9},           {"up", KEY_ARROWUP},    {"down", KEY_ARROWDOWN},
+    {"left", KEY_ARROWLEFT}, {"right", KEY_ARROWRIGHT},   {"enter", KEY_SELECT},  {"mute", KEY_MUTE},
+    {"volup", KEY_VOLUMEUP}, {"voldown", KEY_VOLUMEDOWN}, {"play", KEY_PLAY},     {"pause", KEY_PAUSE},
+    {"stop", KEY_STOP},      {"exit", KEY_EXIT},          {"info", KEY_INFO},     {"red", KEY_C},
+    {"green", KEY_D},        {"yellow", KEY_A},           {"blue", KEY_B},        {"power", KEY_POWER},
+    {"home", KEY_GUIDE},     {"settings", KEY_HELP},      {"record", KEY_RECORD}, {"input", KEY_INPUTKEY}};
+
+static constexpr KeyTable<std::size(DefaultKeyEntries), maxKeyCode(DefaultKeyEntries) + 1>
+    DefaultKeyTable(DefaultKeyEntries);
+
+static_assert(DefaultKeyTable.findCode("power") == KEY_POWER, "Default key table lookup by name");
+static_assert(DefaultKeyTable.findName(KEY_ARROWUP) == "up", "Default key table lookup by code");
+
+#ifdef HAVE_LINUX_KEY_CODES
+static constexpr KeyTable<std::size(LinuxKeyEntries), maxKeyCode(LinuxKeyEntries) + 1> LinuxKeyTable(LinuxKeyEntries);
+#endif
+
+static std::unique_ptr<const KeyProfile> activeProfile;
+
+static int findFallbackCode(std::string_view name) {
+    int keyCode = DefaultKeyTable.findCode(name);
+#ifdef HAVE_LINUX_KEY_CODES
+    if (keyCode < 0) {
+        keyCode = LinuxKeyTable.findCode(name);
+    }
+#endif
+    return keyCode;
+}
+
+static std::string_view findFallbackName(int keyCode) {
+    std::string_view name = DefaultKeyTable.findName(keyCode);
+#ifdef HAVE_LINUX_KEY_CODES
+    if (name.empty()) {
+        name = LinuxKeyTable.findName(keyCode);
+    }
+#endif
+    return name;
 }
 
 int KeyMap::getKeyCode(const std::string &command) const {
-    auto it = keyMappings.find(command);
-    if (it != keyMappings.end()) {
-        return it->second;
-    } else {
+    int keyCode = findKeyCode(command);
+    if (keyCode < 0) {
         logWarn("Command not found in key map: " + command);
-        return -1;
     }
+    return keyCode;
+}
+
+int KeyMap::findKeyCode(const std::string &command) const {
+    if (!customMappings.empty()) {
+        auto it = customMappings.find(command);
+        if (it != customMappings.end()) {
+            return it->second;
+        }
+    }
+
+    int keyCode = activeProfile ? activeProfile->findCode(command) : -1;
+    return keyCode < 0 ? findFallbackCode(command) : keyCode;
 }
 
 std::string KeyMap::getKeyName(int keyCode) const {
-    for (const auto &pair : keyMappings) {
-        if (pair.second == keyCode) {
-            return pair.first;
+    if (!customNames.empty()) {
+        auto it = customNames.find(keyCode);
+        if (it != customNames.end()) {
+            return it->second;
         }
     }
-    logWarn("Key code not found in key map: " + std::to_string(keyCode));
-    return "";
+
+    std::string_view name = activeProfile ? activeProfile->findName(keyCode) : std::string_view();
+    if (name.empty()) {
+        name = findFallbackName(keyCode);
+    }
+    if (name.empty()) {
+        logWarn("Key code not found in key map: " + std::to_string(keyCode));
+    }
+    return std::string(name);
 }
 
 void KeyMap::addMapping(const std::string &command, int keyCode) {
-    keyMappings[command] = keyCode;
+    customMappings[command] = keyCode;
+    customNames.emplace(keyCode, command);
     logDebug("Added/Updated mapping: " + command + " -> " + std::to_string(keyCode));
 }
+
+void KeyMap::loadProfile(const std::string &filePath) {
+    activeProfile = std::make_unique<const KeyProfile>(
+        filePath, [](const std::string &name) { return findFallbackCode(name); });
+    logInfo("Loaded key map profile " + filePath + " with " + std::to_string(activeProfile->size()) + " keys.");
+}
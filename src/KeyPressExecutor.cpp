@@ -20,9 +20,24 @@
 #include "KeyPressExecutor.h"
 #include "Logger.h"
 
-KeyPressExecutor::KeyPressExecutor(KeyManager &km) : keyManager(km) {}
+#include <algorithm>
+
+KeyPressExecutor::KeyPressExecutor(KeyManager &km, Timeline &timeline) : keyManager(km), timeline(timeline) {}
 
 void KeyPressExecutor::execute(const std::vector<std::string> &args) {
+    if (!args.empty() && args[0] == "key_hold") {
+        executeKeyHold(args);
+        return;
+    }
+    if (!args.empty() && args[0] == "type_text") {
+        executeTypeText(args);
+        return;
+    }
+    if (!args.empty() && (args[0] == "key_down" || args[0] == "key_up" || args[0] == "key_combo")) {
+        executeKeyChord(args);
+        return;
+    }
+
     if (args.size() < 2) {
         logError("Invalid key_press command format. Usage: key_press <key> [repeat]");
         return;
@@ -45,5 +60,89 @@ void KeyPressExecutor::execute(const std::vector<std::string> &args) {
 
     logDebug("Sending key press: " + key + ", repeat: " + std::to_string(repeat));
 
-    keyManager.sendKeyPress(key, repeat);
+    keyManager.sendKeyPress(timeline, key, repeat);
+}
+
+void KeyPressExecutor::executeKeyHold(const std::vector<std::string> &args) {
+    const char *usage = "Invalid key_hold command format. Usage: key_hold <key> <duration> [repeat [delay [period]]]";
+    if (args.size() < 3 || args.size() > 6 || (args.size() > 3 && args[3] != "repeat")) {
+        logError(usage);
+        return;
+    }
+
+    int durationMs = Timeline::parseDuration(args[2]);
+    if (durationMs < 0) {
+        logError("Invalid duration format: " + args[2] + ". Usage examples: 800ms, 2s.");
+        return;
+    }
+
+    int repeatDelayMs = -1;
+    int repeatPeriodMs = 0;
+    if (args.size() > 3) {
+        repeatDelayMs = args.size() > 4 ? Timeline::parseDuration(args[4]) : DefaultRepeatDelayMs;
+        repeatPeriodMs = args.size() > 5 ? Timeline::parseDuration(args[5]) : DefaultRepeatPeriodMs;
+        if (repeatDelayMs < 0 || repeatPeriodMs <= 0) {
+            logError(std::string(usage) + ". Usage examples: key_hold down 3s repeat 250ms 33ms.");
+            return;
+        }
+        repeatDelayMs = timeline.scale(repeatDelayMs);
+        repeatPeriodMs = std::max(1, timeline.scale(repeatPeriodMs));
+    }
+
+    logDebug("Sending key hold: " + args[1] + ", duration: " + std::to_string(durationMs) + "ms" +
+             (repeatDelayMs >= 0 ? ", with autorepeat" : ""));
+
+    keyManager.sendKeyHold(timeline, args[1], timeline.scale(durationMs), repeatDelayMs, repeatPeriodMs);
+}
+
+void KeyPressExecutor::executeKeyChord(const std::vector<std::string> &args) {
+    const std::string &command = args[0];
+    std::vector<std::string> keys(args.begin() + 1, args.end());
+
+    // A trailing duration sets how long a combo is held, e.g. "key_combo home 0 2s".
+    int holdMs = -1;
+    if (command == "key_combo" && keys.size() > 1) {
+        holdMs = Timeline::parseDuration(keys.back());
+        if (holdMs >= 0) {
+            keys.pop_back();
+            holdMs = timeline.scale(holdMs);
+        }
+    }
+
+    if (keys.empty()) {
+        logError("Invalid " + command + " command format. Usage: " + command + " <key> [<key>...]" +
+                 (command == "key_combo" ? " [duration]" : ""));
+        return;
+    }
+
+    logDebug("Sending " + command + " with " + std::to_string(keys.size()) + " key(s)");
+
+    if (command == "key_down") {
+        keyManager.sendKeyDown(timeline, keys);
+    } else if (command == "key_up") {
+        keyManager.sendKeyUp(timeline, keys);
+    } else {
+        keyManager.sendKeyCombo(timeline, keys, holdMs);
+    }
+}
+
+void KeyPressExecutor::executeTypeText(const std::vector<std::string> &args) {
+    if (args.size() != 2 && args.size() != 3) {
+        logError("Invalid type_text command format. Usage: type_text \"<text>\" [interval]");
+        return;
+    }
+
+    int intervalMs = -1;
+    if (args.size() == 3) {
+        intervalMs = Timeline::parseDuration(args[2]);
+        if (intervalMs < 0) {
+            logError("Invalid duration format: " + args[2] + ". Usage examples: 50ms, 1s.");
+            return;
+        }
+        intervalMs = timeline.scale(intervalMs);
+    }
+
+    logDebug("Typing text: " + args[1]);
+
+    keyManager.typeText(timeline, args[1], intervalMs);
 }
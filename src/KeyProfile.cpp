@@ -0,0 +1,244 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KeyProfile.h"
+#include "KeyTable.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr char CacheMagic[8] = "OTTOKMP";
+static constexpr uint32_t CacheVersion = 1;
+static constexpr int MaxProfileKeyCode = 0xFFFF;
+
+KeyProfile::KeyProfile(const std::string &filePath, const std::function<int(const std::string &)> &resolveName) {
+    struct stat st {};
+    if (stat(filePath.c_str(), &st) < 0) {
+        throw std::runtime_error("Could not open key map profile: " + filePath);
+    }
+    int64_t mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    int64_t size = static_cast<int64_t>(st.st_size);
+
+    std::string cachePath = filePath + ".cache";
+    if (readCache(cachePath, mtimeNs, size)) {
+        logDebug("Loaded key map profile from cache: " + cachePath);
+        return;
+    }
+
+    parse(filePath, resolveName);
+    build();
+    writeCache(cachePath, mtimeNs, size);
+    logDebug("Parsed key map profile: " + filePath);
+}
+
+int KeyProfile::findCode(std::string_view name) const {
+    if (entries.empty()) {
+        return -1;
+    }
+    int16_t index = slots[findKeySlot(name, seeds, slots.size())];
+    return (index != KeySlotEmpty && name == entries[index].name) ? entries[index].code : -1;
+}
+
+std::string_view KeyProfile::findName(int code) const {
+    if (code < 0 || static_cast<size_t>(code) >= byCode.size() || byCode[code] == KeySlotEmpty) {
+        return {};
+    }
+    return entries[byCode[code]].name;
+}
+
+size_t KeyProfile::size() const { return entries.size(); }
+
+void KeyProfile::parse(const std::string &filePath, const std::function<int(const std::string &)> &resolveName) {
+    std::ifstream file(filePath);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open key map profile: " + filePath);
+    }
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream iss(line);
+        std::string name;
+        std::string value;
+        if (!(iss >> name) || name[0] == '#') {
+            continue;
+        }
+
+        std::string where = filePath + ":" + std::to_string(lineNumber);
+        if (!(iss >> value)) {
+            throw std::runtime_error("Missing key code at " + where);
+        }
+        if (name.size() > MaxNameLength) {
+            throw std::runtime_error("Key name longer than " + std::to_string(MaxNameLength) + " characters at " +
+                                     where);
+        }
+
+        char *end = nullptr;
+        long code = std::strtol(value.c_str(), &end, 0);
+        if (end == value.c_str() || *end != '\0') {
+            code = resolveName(value);
+        }
+        if (code < 0 || code > MaxProfileKeyCode) {
+            throw std::runtime_error("Unknown key code '" + value + "' at " + where);
+        }
+
+        Entry entry{};
+        memcpy(entry.name, name.c_str(), name.size());
+        entry.code = static_cast<int32_t>(code);
+        entries.push_back(entry);
+    }
+}
+
+void KeyProfile::build() {
+    if (entries.size() >= static_cast<size_t>(INT16_MAX)) {
+        throw std::runtime_error("Key map profile has too many entries.");
+    }
+
+    seeds.assign(entries.size() / 2 + 1, 0);
+    slots.assign(nextPowerOfTwo(2 * entries.size()), KeySlotEmpty);
+
+    std::vector<size_t> bucketOf(entries.size());
+    std::vector<size_t> bucketSize(seeds.size());
+    if (!buildKeyHash([this](size_t i) { return std::string_view(entries[i].name); }, entries.size(), bucketOf,
+                      bucketSize, seeds, slots)) {
+        throw std::runtime_error("Key map profile lists the same key name more than once.");
+    }
+
+    int32_t maxCode = -1;
+    for (const auto &entry : entries) {
+        maxCode = entry.code > maxCode ? entry.code : maxCode;
+    }
+    byCode.assign(static_cast<size_t>(maxCode + 1), KeySlotEmpty);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (byCode[entries[i].code] == KeySlotEmpty) {
+            byCode[entries[i].code] = static_cast<int16_t>(i);
+        }
+    }
+}
+
+bool KeyProfile::readCache(const std::string &cachePath, int64_t mtimeNs, int64_t size) {
+    std::ifstream cache(cachePath, std::ios::binary);
+    if (!cache.is_open()) {
+        return false;
+    }
+
+    CacheHeader header{};
+    if (!cache.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+        memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.version != CacheVersion ||
+        header.sourceMtimeNs != mtimeNs || header.sourceSize != size || header.entryCount >= INT16_MAX ||
+        header.bucketCount != header.entryCount / 2 + 1 || header.slotCount != nextPowerOfTwo(2 * header.entryCount) ||
+        header.codeLimit > MaxProfileKeyCode + 1) {
+        return false;
+    }
+
+    entries.resize(header.entryCount);
+    seeds.resize(header.bucketCount);
+    slots.resize(header.slotCount);
+    byCode.resize(header.codeLimit);
+
+    bool complete = cache.read(reinterpret_cast<char *>(entries.data()), entries.size() * sizeof(Entry)) &&
+                    cache.read(reinterpret_cast<char *>(seeds.data()), seeds.size() * sizeof(uint16_t)) &&
+                    cache.read(reinterpret_cast<char *>(slots.data()), slots.size() * sizeof(int16_t)) &&
+                    cache.read(reinterpret_cast<char *>(byCode.data()), byCode.size() * sizeof(int16_t));
+
+    // Indices come from disk, so make sure none of them can point outside the entries.
+    auto validIndex = [this](int16_t index) {
+        return index == KeySlotEmpty || (index >= 0 && static_cast<size_t>(index) < entries.size());
+    };
+    for (size_t i = 0; complete && i < slots.size(); ++i) {
+        complete = validIndex(slots[i]);
+    }
+    for (size_t i = 0; complete && i < byCode.size(); ++i) {
+        complete = validIndex(byCode[i]);
+    }
+    for (auto &entry : entries) {
+        entry.name[MaxNameLength] = '\0';
+    }
+
+    // The tables must also agree with each other: every name hashes to its own entry, and every
+    // code leads to an entry with that code.
+    for (size_t i = 0; complete && i < entries.size(); ++i) {
+        const Entry &entry = entries[i];
+        complete = slots[findKeySlot(entry.name, seeds, slots.size())] == static_cast<int16_t>(i) &&
+                   entry.code >= 0 && static_cast<size_t>(entry.code) < byCode.size() &&
+                   byCode[entry.code] != KeySlotEmpty;
+    }
+    for (size_t code = 0; complete && code < byCode.size(); ++code) {
+        complete = byCode[code] == KeySlotEmpty || entries[byCode[code]].code == static_cast<int32_t>(code);
+    }
+
+    if (!complete) {
+        entries.clear();
+        seeds.clear();
+        slots.clear();
+        byCode.clear();
+        logWarn("Ignoring corrupt key map cache: " + cachePath);
+    }
+    return complete;
+}
+
+void KeyProfile::writeCache(const std::string &cachePath, int64_t mtimeNs, int64_t size) const {
+    CacheHeader header{};
+    memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.sourceMtimeNs = mtimeNs;
+    header.sourceSize = size;
+    header.bucketCount = static_cast<uint32_t>(seeds.size());
+    header.slotCount = static_cast<uint32_t>(slots.size());
+    header.codeLimit = static_cast<uint32_t>(byCode.size());
+
+    std::string content(reinterpret_cast<const char *>(&header), sizeof(header));
+    content.append(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+    content.append(reinterpret_cast<const char *>(seeds.data()), seeds.size() * sizeof(uint16_t));
+    content.append(reinterpret_cast<const char *>(slots.data()), slots.size() * sizeof(int16_t));
+    content.append(reinterpret_cast<const char *>(byCode.data()), byCode.size() * sizeof(int16_t));
+
+    // Written to a file of its own and renamed into place, so processes loading the profile at
+    // the same time, or a crash, never leave a torn cache behind.
+    std::string tempPath = cachePath + ".XXXXXX";
+    int fd = mkostemp(&tempPath[0], O_CLOEXEC);
+    bool written = fd >= 0 && fchmod(fd, 0644) == 0 &&
+                   write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()) && fsync(fd) == 0;
+    int error = errno;
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (written && std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        written = false;
+        error = errno;
+    }
+    if (!written) {
+        if (fd >= 0) {
+            std::remove(tempPath.c_str());
+        }
+        logWarn("Could not write key map cache: " + cachePath + " (" + strerror(error) +
+                "). The profile will be parsed on every run.");
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LatencyHistogram.h"
+
+void LatencyHistogram::add(int64_t latencyUs) {
+    if (latencyUs < 0) {
+        latencyUs = 0;
+    }
+
+    size_t bucket = static_cast<size_t>(latencyUs / BucketUs);
+    ++buckets[bucket < BucketCount ? bucket : BucketCount - 1];
+    ++samples;
+    totalUs += latencyUs;
+    maxUs = latencyUs > maxUs ? latencyUs : maxUs;
+}
+
+void LatencyHistogram::reset() { *this = LatencyHistogram(); }
+
+uint64_t LatencyHistogram::count() const { return samples; }
+
+int64_t LatencyHistogram::percentile(double fraction) const {
+    if (samples == 0) {
+        return 0;
+    }
+
+    auto rank = static_cast<uint64_t>(fraction * static_cast<double>(samples));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += buckets[bucket];
+        if (seen > rank) {
+            // The last bucket is open-ended, so the maximum is the best bound for it.
+            return bucket + 1 < BucketCount ? static_cast<int64_t>(bucket + 1) * BucketUs : maxUs;
+        }
+    }
+    return maxUs;
+}
+
+std::string LatencyHistogram::summary() const {
+    if (samples == 0) {
+        return "no samples";
+    }
+    return std::to_string(samples) + " samples, mean " + std::to_string(totalUs / static_cast<int64_t>(samples)) +
+           "us, p50 <= " + std::to_string(percentile(0.5)) + "us, p99 <= " + std::to_string(percentile(0.99)) +
+           "us, max " + std::to_string(maxUs) + "us";
+}
@@ -0,0 +1,294 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogWatcher.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+// Appends are reported as IN_MODIFY on the directory; the rest follow the name being replaced.
+constexpr uint32_t DirectoryMask = IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+} // namespace
+
+LogWatcher::LogWatcher() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        throw std::runtime_error("Failed to initialize inotify for log watching: " + std::string(strerror(errno)));
+    }
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) {
+        close(inotifyFd);
+        throw std::runtime_error("Failed to create log watcher wake-up eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+LogWatcher::~LogWatcher() {
+    if (watchThread.joinable()) {
+        isRunning = false;
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {
+            logWarn("Failed to wake the log watcher thread: " + std::string(strerror(errno)));
+        }
+        watchThread.join();
+    }
+    for (auto &entry : watches) {
+        closeFile(entry.second);
+    }
+    close(wakeFd);
+    close(inotifyFd);
+}
+
+LogWatcher &LogWatcher::getInstance() {
+    static LogWatcher instance;
+    return instance;
+}
+
+size_t LogWatcher::addWatch(const std::string &path, std::shared_ptr<const std::regex> pattern,
+                            MatchListener listener) {
+    Watch watch;
+    watch.path = path;
+    watch.pattern = std::move(pattern);
+    watch.listener = std::move(listener);
+
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    watch.fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+    if (watch.fileName.empty()) {
+        throw std::runtime_error("Not a file: " + path);
+    }
+
+    std::lock_guard<std::mutex> lock(watchMutex);
+
+    // The same directory always yields the same wd, however its path is spelled.
+    watch.directoryWd = inotify_add_watch(inotifyFd, directory.c_str(), DirectoryMask);
+    if (watch.directoryWd < 0) {
+        throw std::runtime_error("Failed to watch directory " + directory + ": " + std::string(strerror(errno)));
+    }
+    ++directoryRefs[watch.directoryWd];
+
+    // Opened after the directory is watched, so no append falls between the two.
+    openFile(watch, true);
+
+    // A thread that failed has cleared isRunning under watchMutex, so all that is left is to join it.
+    if (!isRunning) {
+        if (watchThread.joinable()) {
+            watchThread.join();
+        }
+        isRunning = true;
+        watchThread = std::thread(&LogWatcher::watchLoop, this);
+    }
+
+    size_t watchId = nextWatchId++;
+    watches.emplace(watchId, std::move(watch));
+    return watchId;
+}
+
+void LogWatcher::removeWatch(size_t watchId) {
+    std::lock_guard<std::mutex> lock(watchMutex);
+    auto it = watches.find(watchId);
+    if (it == watches.end()) {
+        return;
+    }
+
+    closeFile(it->second);
+    auto refs = directoryRefs.find(it->second.directoryWd);
+    if (refs != directoryRefs.end() && --refs->second == 0) {
+        inotify_rm_watch(inotifyFd, refs->first);
+        directoryRefs.erase(refs);
+    }
+    watches.erase(it);
+}
+
+void LogWatcher::watchLoop() {
+    struct pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+
+    while (isRunning) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::string reason = "Poll failed while watching log files: " + std::string(strerror(errno));
+            logError(reason);
+            std::lock_guard<std::mutex> lock(watchMutex);
+            failWatches(reason);
+            isRunning = false;
+            return;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            handleEvents();
+        }
+    }
+}
+
+void LogWatcher::failWatches(const std::string &reason) {
+    for (auto &entry : watches) {
+        Watch &watch = entry.second;
+        if (!watch.matched) {
+            watch.matched = true;
+            closeFile(watch);
+            watch.listener(false, reason);
+        }
+    }
+}
+
+void LogWatcher::handleEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+
+    ssize_t length;
+    while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+        std::lock_guard<std::mutex> lock(watchMutex);
+
+        for (char *ptr = buffer; ptr < buffer + length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            for (auto &entry : watches) {
+                Watch &watch = entry.second;
+                // On overflow events were dropped, so every watch catches up.
+                if ((event->mask & IN_Q_OVERFLOW) ||
+                    (event->wd == watch.directoryWd && event->len > 0 && watch.fileName == event->name)) {
+                    readWatch(watch);
+                }
+            }
+        }
+    }
+}
+
+void LogWatcher::readWatch(Watch &watch) {
+    if (watch.matched) {
+        return;
+    }
+
+    if (watch.fd >= 0) {
+        if (!readAppended(watch)) {
+            logDebug("Log file truncated, reading it from the start: " + watch.path);
+            watch.offset = 0;
+            watch.partialLine.clear();
+            watch.skippingLine = false;
+            readAppended(watch);
+        }
+
+        // Whatever was appended to the old file has been read, so a replaced path can be followed.
+        struct stat st;
+        if (!watch.matched && (stat(watch.path.c_str(), &st) != 0 || st.st_ino != watch.inode)) {
+            logDebug("Log file rotated: " + watch.path);
+            closeFile(watch);
+        }
+    }
+
+    if (watch.fd < 0 && !watch.matched && openFile(watch, false)) {
+        readAppended(watch);
+    }
+}
+
+bool LogWatcher::readAppended(Watch &watch) {
+    struct stat st;
+    if (fstat(watch.fd, &st) == 0 && st.st_size < watch.offset) {
+        return false;
+    }
+
+    char buffer[ReadChunkSize];
+    ssize_t length;
+    while ((length = pread(watch.fd, buffer, sizeof(buffer), watch.offset)) > 0) {
+        watch.offset += length;
+
+        const char *data = buffer;
+        size_t size = static_cast<size_t>(length);
+        if (watch.skippingLine) {
+            const char *newline = static_cast<const char *>(memchr(data, '\n', size));
+            if (newline == nullptr) {
+                continue;
+            }
+            size -= static_cast<size_t>(newline - data);
+            data = newline;
+            watch.skippingLine = false;
+        }
+
+        // Only the new bytes can complete a line, so the search starts where they do.
+        size_t lineStart = 0;
+        size_t searchFrom = watch.partialLine.size();
+        watch.partialLine.append(data, size);
+
+        size_t newline;
+        while ((newline = watch.partialLine.find('\n', searchFrom)) != std::string::npos) {
+            size_t lineEnd = newline;
+            if (lineEnd > lineStart && watch.partialLine[lineEnd - 1] == '\r') {
+                --lineEnd;
+            }
+            std::string line = watch.partialLine.substr(lineStart, lineEnd - lineStart);
+            if (std::regex_search(line, *watch.pattern)) {
+                watch.matched = true;
+                closeFile(watch);
+                watch.listener(true, line);
+                return true;
+            }
+            lineStart = newline + 1;
+            searchFrom = lineStart;
+        }
+        watch.partialLine.erase(0, lineStart);
+
+        // A log without newlines must not grow the buffer without bound.
+        if (watch.partialLine.size() > MaxLineLength) {
+            logDebug("Line longer than " + std::to_string(MaxLineLength) + " bytes in " + watch.path +
+                     ", matching its start only.");
+            watch.partialLine.resize(MaxLineLength);
+            watch.skippingLine = true;
+        }
+    }
+
+    return true;
+}
+
+bool LogWatcher::openFile(Watch &watch, bool fromEnd) {
+    watch.fd = open(watch.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (watch.fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(watch.fd, &st) != 0) {
+        closeFile(watch);
+        return false;
+    }
+    watch.inode = st.st_ino;
+    watch.offset = fromEnd ? st.st_size : 0;
+    watch.partialLine.clear();
+    watch.skippingLine = false;
+    return true;
+}
+
+void LogWatcher::closeFile(Watch &watch) {
+    if (watch.fd >= 0) {
+        close(watch.fd);
+        watch.fd = -1;
+    }
+}
@@ -55,8 +55,24 @@ LogLevel stringToLogLevel(const std::string &levelStr) {
     }
 }
 
+static thread_local std::string logContextName;
+static thread_local std::string logContext;
+static thread_local LogLevel logContextLevel = LogLevel::TRACE;
+
+void setLogContext(const std::string &context, LogLevel minLevel) {
+    logContextName = context;
+    logContext = context.empty() ? context : "[" + context + "] ";
+    logContextLevel = minLevel;
+}
+
+const std::string &getLogContext() { return logContextName; }
+
+LogLevel getLogContextLevel() { return logContextLevel; }
+
+bool isLogEnabled(LogLevel level) { return level >= LoggerConfig::currentLevel && level >= logContextLevel; }
+
 void logMessage(LogLevel level, const std::string &message) {
-    if (level < LoggerConfig::currentLevel) {
+    if (!isLogEnabled(level)) {
         return;
     }
 
@@ -89,7 +105,8 @@ void logMessage(LogLevel level, const std::string &message) {
         break;
     }
 
+    // Write each entry with a single call so entries from concurrent threads don't interleave.
     std::ostringstream logEntry;
-    logEntry << "[" << timestamp.str() << "]" << levelStr << message;
-    std::cout << logEntry.str() << std::endl;
+    logEntry << "[" << timestamp.str() << "]" << levelStr << logContext << message << '\n';
+    std::cout << logEntry.str() << std::flush;
 }
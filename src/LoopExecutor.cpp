@@ -70,3 +70,18 @@ void LoopExecutor::execute(const std::vector<std::string> &args) {
         logError("Unknown loop command: " + command);
     }
 }
+
+std::vector<std::pair<int, int>> LoopExecutor::getLoops() const {
+    std::vector<std::pair<int, int>> loops;
+    for (auto stack = loopStack; !stack.empty(); stack.pop()) {
+        loops.push_back(stack.top());
+    }
+    return std::vector<std::pair<int, int>>(loops.rbegin(), loops.rend());
+}
+
+void LoopExecutor::setLoops(const std::vector<std::pair<int, int>> &loops) {
+    loopStack = std::stack<std::pair<int, int>>();
+    for (const auto &loop : loops) {
+        loopStack.push(loop);
+    }
+}
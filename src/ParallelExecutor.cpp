@@ -0,0 +1,97 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ParallelExecutor.h"
+#include "Logger.h"
+
+#include <stdexcept>
+
+ParallelExecutor::ParallelExecutor(std::shared_ptr<CommandExecutor> executor, BranchRunner runBranches)
+    : executor(std::move(executor)), runBranches(std::move(runBranches)) {}
+
+void ParallelExecutor::execute(const std::vector<std::string> &args) {
+    if (args.empty()) {
+        logError("Invalid parallel command. Usage: parallel_start, branch or parallel_end.");
+        return;
+    }
+
+    const std::string &command = args[0];
+
+    if (command == "shard") {
+        // Only marks where the script may be split; run as a whole, it continues right away.
+        logDebug("Passed shard marker.");
+        return;
+    }
+    if (command == "branch" || command == "parallel_end") {
+        // Reached only when no parallel_start skipped over it.
+        logError(command + " encountered without matching parallel_start.");
+        return;
+    }
+    if (command != "parallel_start") {
+        logError("Unknown parallel command: " + command);
+        return;
+    }
+
+    size_t startIndex = executor->getCurrentCommandIndex();
+    size_t endIndex = startIndex;
+    std::vector<Commands> branches = collectBranches(startIndex, endIndex);
+
+    logDebug("Parallel block started with " + std::to_string(branches.size()) + " branches.");
+
+    executor->setCommandIndex(endIndex);
+    runBranches(std::move(branches));
+}
+
+std::vector<ParallelExecutor::Commands> ParallelExecutor::collectBranches(size_t startIndex, size_t &endIndex) const {
+    const Commands &commands = executor->getParsedCommands();
+    std::vector<Commands> branches;
+    Commands current;
+    int depth = 0;
+
+    for (size_t index = startIndex + 1; index < commands.size(); ++index) {
+        const std::string &command = commands[index][0];
+
+        if (command == "parallel_end" && depth == 0) {
+            if (!current.empty()) {
+                branches.push_back(std::move(current));
+            }
+            endIndex = index;
+            return branches;
+        }
+
+        if (command == "branch" && depth == 0) {
+            if (!current.empty()) {
+                branches.push_back(std::move(current));
+                current.clear();
+            }
+            continue;
+        }
+
+        // Nested blocks belong to the branch and are run by its own executor.
+        if (command == "parallel_start") {
+            ++depth;
+        } else if (command == "parallel_end") {
+            --depth;
+        }
+        current.push_back(commands[index]);
+    }
+
+    logError("parallel_start at command " + std::to_string(startIndex + 1) + " has no matching parallel_end.");
+    throw std::runtime_error("Unterminated parallel block.");
+}
@@ -0,0 +1,209 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordWriter.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+RecordWriter::RecordWriter(const KeyMap &keyMap) : encoder(keyMap, true) {}
+
+RecordWriter::~RecordWriter() { stop(); }
+
+void RecordWriter::start(const std::string &outputFile, RecordFormat outputFormat) {
+    if (isRunning) {
+        logWarn("Record writer already running.");
+        return;
+    }
+
+    fd = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        logError("Failed to open file for writing: " + outputFile);
+        throw std::runtime_error("Could not open record file.");
+    }
+
+    filePath = outputFile;
+    format = outputFormat;
+    droppedRecords = 0;
+    writtenDevices.clear();
+
+    if (format == RecordFormat::Binary) {
+        CaptureFileHeader header{};
+        memcpy(header.magic, CaptureMagic, sizeof(CaptureMagic));
+        header.version = CaptureVersion;
+        header.recordSize = sizeof(InputRecord);
+        pending.assign(reinterpret_cast<const char *>(&header), sizeof(header));
+    } else {
+        encoder.reset();
+        pending = encoder.header();
+    }
+    isRunning = true;
+    writerThread = std::thread(&RecordWriter::writerLoop, this);
+}
+
+void RecordWriter::stop() {
+    if (!isRunning.exchange(false)) {
+        return;
+    }
+
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    // The producer has stopped by now, so whatever is left can be drained from here.
+    drain();
+    if (format == RecordFormat::Text) {
+        encoder.finish(pending);
+    }
+    flush(true);
+    close(fd);
+    fd = -1;
+
+    if (droppedRecords > 0) {
+        logWarn("Dropped " + std::to_string(droppedRecords.load()) + " events because the record queue was full.");
+    }
+    logInfo("Recorded events written to file: " + filePath);
+}
+
+bool RecordWriter::push(const InputRecord &record) {
+    if (!ring.tryPush(record)) {
+        droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void RecordWriter::pushWaiting(const InputRecord &record) {
+    while (!ring.tryPush(record)) {
+        std::this_thread::yield();
+    }
+}
+
+void RecordWriter::addDevice(uint16_t deviceId, const std::string &name,
+                             const CaptureDeviceCapabilities *capabilities) {
+    std::string capabilityBytes;
+    if (capabilities) {
+        capabilityBytes.assign(reinterpret_cast<const char *>(capabilities), sizeof(*capabilities));
+    }
+
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    newDevices.push_back({deviceId, name, std::move(capabilityBytes)});
+}
+
+void RecordWriter::writerLoop() {
+    auto lastFlush = std::chrono::steady_clock::now();
+
+    while (isRunning) {
+        drain();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastFlush >= std::chrono::milliseconds(FlushIntervalMs)) {
+            flush(true);
+            lastFlush = now;
+        } else if (ring.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(IdleSleepMs));
+        }
+    }
+}
+
+void RecordWriter::drain() {
+    drainDevices();
+
+    InputRecord record;
+    while (ring.tryPop(record)) {
+        if (format == RecordFormat::Text) {
+            encoder.encode(record, pending);
+            continue;
+        }
+
+        // A device may have been announced after the last check but before its first record.
+        if (record.deviceId >= writtenDevices.size() || !writtenDevices[record.deviceId]) {
+            drainDevices();
+        }
+        pending.append(reinterpret_cast<const char *>(&record), sizeof(record));
+    }
+
+    // Keep the batch bounded even if the flush deadline has not been reached.
+    if (pending.size() >= 64 * 1024) {
+        flush(false);
+    }
+}
+
+void RecordWriter::drainDevices() {
+    std::vector<DeviceInfo> devices;
+    {
+        std::lock_guard<std::mutex> lock(deviceMutex);
+        devices.swap(newDevices);
+    }
+
+    for (const auto &device : devices) {
+        if (device.id >= writtenDevices.size()) {
+            writtenDevices.resize(device.id + 1, false);
+        }
+        writtenDevices[device.id] = true;
+
+        if (format != RecordFormat::Binary) {
+            continue;
+        }
+
+        appendMetadata(INPUT_TYPE_DEVICE, device.id, device.name);
+        if (!device.capabilities.empty()) {
+            appendMetadata(INPUT_TYPE_CAPABILITIES, device.id, device.capabilities);
+        }
+    }
+}
+
+void RecordWriter::appendMetadata(uint16_t type, uint16_t deviceId, const std::string &payload) {
+    InputRecord descriptor{};
+    descriptor.deviceId = deviceId;
+    descriptor.type = type;
+    descriptor.value = static_cast<int32_t>(payload.size());
+    pending.append(reinterpret_cast<const char *>(&descriptor), sizeof(descriptor));
+    pending.append(payload);
+    pending.append(payloadRecords(descriptor) * sizeof(InputRecord) - payload.size(), '\0');
+}
+
+void RecordWriter::flush(bool sync) {
+    size_t offset = 0;
+    while (offset < pending.size()) {
+        ssize_t written = write(fd, pending.data() + offset, pending.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logError("Failed to write recorded events to " + filePath + ": " + std::string(strerror(errno)));
+            break;
+        }
+        offset += static_cast<size_t>(written);
+        unsynced = true;
+    }
+    pending.clear();
+
+    if (sync && unsynced) {
+        if (fdatasync(fd) < 0) {
+            logWarn("Failed to sync record file " + filePath + ": " + std::string(strerror(errno)));
+        }
+        unsynced = false;
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Scheduler.h"
+
+#include <algorithm>
+
+Scheduler::Scheduler(size_t workerCount) : epoch(Clock::now()), wheel(WheelSlots, nullptr) {
+    timerThread = std::thread(&Scheduler::timerLoop, this);
+    for (size_t i = 0; i < std::max<size_t>(1, workerCount); ++i) {
+        workers.emplace_back(&Scheduler::workerLoop, this);
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    timerCondition.notify_all();
+    readyCondition.notify_all();
+
+    timerThread.join();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+void Scheduler::schedule(Task &task, Clock::time_point due) {
+    // Round up, so a task never runs before it is due.
+    auto dueUs = std::chrono::duration_cast<std::chrono::microseconds>(due - epoch).count();
+    auto tickUs = std::chrono::duration_cast<std::chrono::microseconds>(TickDuration).count();
+    int64_t dueTick = (dueUs + tickUs - 1) / tickUs;
+
+    auto now = Clock::now();
+    bool ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (timerCount == 0) {
+            // The wheel is empty, so skip the idle ticks instead of having the timer visit them.
+            currentTick = std::max(currentTick, tickOf(now));
+        }
+        ready = due <= now || dueTick <= currentTick || task.wakeRequested;
+        task.wakeRequested = false;
+        if (ready) {
+            readyTasks.push_back(&task);
+        } else {
+            task.dueTick = dueTick;
+            task.inWheel = true;
+            auto &slot = wheel[dueTick % WheelSlots];
+            task.nextTimer = slot;
+            slot = &task;
+            ++timerCount;
+        }
+    }
+
+    if (ready) {
+        readyCondition.notify_one();
+    } else {
+        timerCondition.notify_one();
+    }
+}
+
+void Scheduler::schedule(Task &task) { schedule(task, Clock::now()); }
+
+void Scheduler::wake(Task &task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!task.inWheel) {
+            task.wakeRequested = true;
+            return;
+        }
+
+        Task **link = &wheel[task.dueTick % WheelSlots];
+        while (*link != &task) {
+            link = &(*link)->nextTimer;
+        }
+        *link = task.nextTimer;
+        task.nextTimer = nullptr;
+        task.inWheel = false;
+        --timerCount;
+        readyTasks.push_back(&task);
+    }
+    readyCondition.notify_one();
+}
+
+void Scheduler::timerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (timerCount == 0) {
+            // Nothing is waiting, so there is no slot to visit until something is scheduled.
+            timerCondition.wait(lock);
+            continue;
+        }
+
+        int64_t nowTick = tickOf(Clock::now());
+
+        size_t ready = 0;
+        while (currentTick < nowTick) {
+            ++currentTick;
+            ready += expireSlot();
+        }
+        if (ready > 0) {
+            lock.unlock();
+            if (ready == 1) {
+                readyCondition.notify_one();
+            } else {
+                readyCondition.notify_all();
+            }
+            lock.lock();
+            continue;
+        }
+
+        timerCondition.wait_until(lock, tickTime(nextOccupiedTick()));
+    }
+}
+
+void Scheduler::workerLoop() {
+    for (;;) {
+        Task *task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            readyCondition.wait(lock, [this]() { return stopping || !readyTasks.empty(); });
+            if (stopping) {
+                return;
+            }
+            task = readyTasks.front();
+            readyTasks.pop_front();
+        }
+        task->resume(*this);
+    }
+}
+
+size_t Scheduler::expireSlot() {
+    size_t ready = 0;
+    Task **link = &wheel[currentTick % WheelSlots];
+    while (Task *task = *link) {
+        if (task->dueTick <= currentTick) {
+            *link = task->nextTimer;
+            task->nextTimer = nullptr;
+            task->inWheel = false;
+            readyTasks.push_back(task);
+            --timerCount;
+            ++ready;
+        } else {
+            link = &task->nextTimer;
+        }
+    }
+    return ready;
+}
+
+int64_t Scheduler::nextOccupiedTick() const {
+    for (size_t offset = 1; offset < WheelSlots; ++offset) {
+        if (wheel[(currentTick + offset) % WheelSlots]) {
+            return currentTick + offset;
+        }
+    }
+    return currentTick + WheelSlots;
+}
+
+int64_t Scheduler::tickOf(Clock::time_point time) const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch) / TickDuration;
+}
+
+Scheduler::Clock::time_point Scheduler::tickTime(int64_t tick) const { return epoch + tick * TickDuration; }
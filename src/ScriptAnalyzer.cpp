@@ -0,0 +1,287 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptAnalyzer.h"
+#include "CaptureFile.h"
+#include "CommandHandler.h"
+#include "Logger.h"
+#include "ScriptTask.h"
+#include "SimulatedOutput.h"
+#include "Timeline.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <memory>
+#include <regex>
+#include <unordered_set>
+
+namespace {
+/**
+ * The number of arguments each command takes, counting the command itself.
+ */
+const struct {
+    const char *command;
+    size_t minArgs;
+    size_t maxArgs;
+    const char *usage;
+} CommandArities[] = {
+    {"var", 3, 3, "var <name> <value>"},
+    {"key_press", 2, 3, "key_press <key> [repeat]"},
+    {"key_hold", 3, 6, "key_hold <key> <duration> [repeat [delay [period]]]"},
+    {"key_down", 2, SIZE_MAX, "key_down <key> [<key>...]"},
+    {"key_up", 2, SIZE_MAX, "key_up <key> [<key>...]"},
+    {"key_combo", 2, SIZE_MAX, "key_combo <key> [<key>...] [duration]"},
+    {"type_text", 2, 3, "type_text \"<text>\" [interval]"},
+    {"loop_start", 2, 2, "loop_start <count>"},
+    {"loop_end", 1, 1, "loop_end"},
+    {"parallel_start", 1, 1, "parallel_start"},
+    {"branch", 1, 1, "branch"},
+    {"parallel_end", 1, 1, "parallel_end"},
+    {"shard", 1, 1, "shard"},
+    {"wait", 2, 2, "wait <duration>"},
+    {"timeline", 2, 2, "timeline <absolute|relative>"},
+    {"wait_for_key", 2, 3, "wait_for_key <key> [timeout]"},
+    {"wait_for_log", 3, 4, "wait_for_log <file> <regex> [timeout]"},
+    {"launch_app", 2, 2, "launch_app <app_id>"},
+    {"close_app", 2, 2, "close_app <app_id>"}};
+
+bool isVariable(const std::string &arg) { return !arg.empty() && arg[0] == '$'; }
+
+/**
+ * Values of variables are only known when the script runs, so they pass every check.
+ */
+bool isDuration(const std::string &arg) { return isVariable(arg) || Timeline::parseDuration(arg) >= 0; }
+
+bool isCount(const std::string &arg) {
+    if (isVariable(arg)) {
+        return true;
+    }
+    if (arg.empty() || arg.size() > 9 || !std::all_of(arg.begin(), arg.end(), ::isdigit)) {
+        return false;
+    }
+    return std::stoi(arg) > 0;
+}
+} // namespace
+
+ScriptAnalyzer::ScriptAnalyzer(int intervalMs, double speed) : intervalMs(intervalMs), speed(speed) {}
+
+ScriptAnalysis ScriptAnalyzer::analyze(const std::string &commandsFile) const {
+    if (CaptureFile::isCaptureFile(commandsFile)) {
+        ScriptAnalysis analysis;
+        analysis.commandsFile = commandsFile;
+        analysis.problems.push_back("Capture files are replayed as recorded and cannot be analyzed.");
+        return analysis;
+    }
+
+    try {
+        return analyze(commandsFile, CommandHandler::parseCommands(commandsFile));
+    } catch (const std::exception &e) {
+        ScriptAnalysis analysis;
+        analysis.commandsFile = commandsFile;
+        analysis.problems.push_back(e.what());
+        return analysis;
+    }
+}
+
+ScriptAnalysis ScriptAnalyzer::analyze(const std::string &name,
+                                       const std::vector<std::vector<std::string>> &commands) const {
+    ScriptAnalysis analysis;
+    analysis.commandsFile = name;
+    analysis.commandCount = commands.size();
+
+    auto simulation = std::make_shared<SimulatedOutput>();
+    Timeline timeline(speed);
+    timeline.simulate(simulation, simulation->getStart());
+    ScriptTask task(timeline, intervalMs, 0, name);
+    task.getCommandExecutor()->setParsedCommands(commands);
+
+    validate(*task.getCommandExecutor(), analysis);
+    if (!analysis.problems.empty()) {
+        return analysis;
+    }
+
+    // The commands have been checked, so only warnings and errors of the run itself are of interest.
+    // The task runs on this thread and takes over its log context, which is restored afterwards.
+    task.setMinLogLevel(LogLevel::WARN);
+    std::string logContext = getLogContext();
+    LogLevel logContextLevel = getLogContextLevel();
+    task.run();
+    setLogContext(logContext, logContextLevel);
+
+    if (!task.succeeded()) {
+        analysis.problems.push_back(task.getError());
+        return analysis;
+    }
+
+    analysis.durationMs = task.getElapsedMs();
+    analysis.keyEvents = simulation->getEventCount();
+    analysis.appActions = simulation->getAppActionCount();
+    return analysis;
+}
+
+void ScriptAnalyzer::validate(const CommandExecutor &executor, ScriptAnalysis &analysis) const {
+    struct OpenBlock {
+        std::string command; ///< loop_start or parallel_start.
+        size_t number;       ///< 1-based command number.
+    };
+    std::vector<OpenBlock> blocks;
+    std::unordered_set<std::string> variables;
+    const auto &commands = executor.getParsedCommands();
+
+    for (size_t index = 0; index < commands.size(); ++index) {
+        const Command &command = commands[index];
+        const std::string &name = command[0];
+        auto addProblem = [&](const std::string &message) {
+            analysis.problems.push_back("Command " + std::to_string(index + 1) + " (" + name + "): " + message);
+        };
+
+        if (!executor.hasCommand(name)) {
+            addProblem("unknown command.");
+            continue;
+        }
+
+        for (size_t i = 1; i < command.size(); ++i) {
+            if (isVariable(command[i]) && variables.count(command[i].substr(1)) == 0) {
+                addProblem("variable " + command[i].substr(1) + " is used before it is defined.");
+            }
+        }
+        if (name == "var" && command.size() == 3) {
+            variables.insert(command[1]);
+        }
+
+        // Branches are split before they run, so a loop must end in the branch it starts in.
+        if (name == "loop_start" || name == "parallel_start") {
+            blocks.push_back({name, index + 1});
+        } else if (name == "loop_end") {
+            if (blocks.empty() || blocks.back().command != "loop_start") {
+                addProblem("no matching loop_start" + std::string(blocks.empty() ? "." : " in this branch."));
+            } else {
+                blocks.pop_back();
+            }
+        } else if (name == "shard") {
+            if (!blocks.empty()) {
+                addProblem("shard markers must not be inside a loop or parallel block.");
+            }
+        } else if (name == "branch" || name == "parallel_end") {
+            while (!blocks.empty() && blocks.back().command == "loop_start") {
+                addProblem("loop_start at command " + std::to_string(blocks.back().number) +
+                           " is not closed before it.");
+                blocks.pop_back();
+            }
+            if (blocks.empty()) {
+                addProblem("no matching parallel_start.");
+            } else if (name == "parallel_end") {
+                blocks.pop_back();
+            }
+        }
+
+        std::string error = checkArguments(command);
+        if (!error.empty()) {
+            addProblem(error);
+        }
+    }
+
+    for (const OpenBlock &block : blocks) {
+        analysis.problems.push_back("Command " + std::to_string(block.number) + " (" + block.command +
+                                    "): not closed by " +
+                                    (block.command == "loop_start" ? "loop_end." : "parallel_end."));
+    }
+}
+
+std::string ScriptAnalyzer::checkArguments(const Command &command) const {
+    const std::string &name = command[0];
+    for (const auto &arity : CommandArities) {
+        if (name == arity.command && (command.size() < arity.minArgs || command.size() > arity.maxArgs)) {
+            return std::string("usage: ") + arity.usage;
+        }
+    }
+
+    if (name == "key_press") {
+        if (!isKey(command[1])) {
+            return "unknown key: " + command[1];
+        }
+        if (command.size() == 3 && !isCount(command[2])) {
+            return "invalid repeat count: " + command[2];
+        }
+    } else if (name == "key_hold") {
+        if (!isKey(command[1])) {
+            return "unknown key: " + command[1];
+        }
+        if (!isDuration(command[2])) {
+            return "invalid duration: " + command[2];
+        }
+        if (command.size() > 3 && command[3] != "repeat") {
+            return "expected repeat instead of " + command[3];
+        }
+        for (size_t i = 4; i < command.size(); ++i) {
+            int durationMs = isVariable(command[i]) ? 1 : Timeline::parseDuration(command[i]);
+            if (durationMs < 0 || (i == 5 && durationMs == 0)) {
+                return "invalid autorepeat " + std::string(i == 4 ? "delay: " : "period: ") + command[i];
+            }
+        }
+    } else if (name == "key_down" || name == "key_up" || name == "key_combo") {
+        size_t end = command.size();
+        if (name == "key_combo" && end > 2 && Timeline::parseDuration(command.back()) >= 0) {
+            --end;
+        }
+        for (size_t i = 1; i < end; ++i) {
+            if (!isKey(command[i])) {
+                return "unknown key: " + command[i];
+            }
+        }
+    } else if (name == "type_text" || name == "wait") {
+        if (command.size() == 3 || name == "wait") {
+            const std::string &duration = command.back();
+            if (!isDuration(duration)) {
+                return "invalid duration: " + duration;
+            }
+        }
+    } else if (name == "loop_start") {
+        if (!isCount(command[1])) {
+            return "invalid loop count: " + command[1];
+        }
+    } else if (name == "timeline") {
+        if (command[1] != "absolute" && command[1] != "relative" && !isVariable(command[1])) {
+            return "invalid mode: " + command[1];
+        }
+    } else if (name == "wait_for_key") {
+        if (!isKey(command[1])) {
+            return "unknown key: " + command[1];
+        }
+        if (command.size() == 3 && !isDuration(command[2])) {
+            return "invalid timeout: " + command[2];
+        }
+    } else if (name == "wait_for_log") {
+        if (!isVariable(command[2])) {
+            try {
+                std::regex pattern(command[2]);
+            } catch (const std::regex_error &e) {
+                return "invalid regex: " + command[2] + " (" + e.what() + ")";
+            }
+        }
+        if (command.size() == 4 && !isDuration(command[3])) {
+            return "invalid timeout: " + command[3];
+        }
+    }
+
+    return std::string();
+}
+
+bool ScriptAnalyzer::isKey(const std::string &arg) const { return isVariable(arg) || keyMap.findKeyCode(arg) >= 0; }
@@ -0,0 +1,175 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptEncoder.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <vector>
+
+ScriptEncoder::ScriptEncoder(const KeyMap &keyMap, bool logCommands) : keyMap(keyMap), logCommands(logCommands) {}
+
+void ScriptEncoder::reset() {
+    pending.clear();
+    overlapping = false;
+    lastTransitionUs = -1;
+}
+
+std::string ScriptEncoder::header() const { return "timeline absolute\n"; }
+
+void ScriptEncoder::encode(const InputRecord &record, std::string &out) {
+    if (record.type != INPUT_TYPE_KEY) {
+        return;
+    }
+
+    if (record.value == INPUT_PRESS) {
+        for (const auto &press : pending) {
+            overlapping = overlapping || press.upUs < 0;
+        }
+        pending.push_back({record.deviceId, record.code, record.timestampUs, -1, 0, -1, -1});
+        // A release that never arrives must not hold back everything recorded after it.
+        if (pending.size() > MaxPendingPresses) {
+            emitCompleted(out, true);
+        }
+    } else if (record.value == INPUT_REPEAT) {
+        if (PendingPress *press = findOpenPress(record)) {
+            if (press->repeats++ == 0) {
+                press->firstRepeatUs = record.timestampUs;
+            }
+            press->lastRepeatUs = record.timestampUs;
+        }
+    } else if (record.value == INPUT_RELEASE) {
+        if (PendingPress *press = findOpenPress(record)) {
+            press->upUs = record.timestampUs;
+        }
+        emitCompleted(out, false);
+    }
+}
+
+ScriptEncoder::PendingPress *ScriptEncoder::findOpenPress(const InputRecord &record) {
+    for (auto &press : pending) {
+        if (press.deviceId == record.deviceId && press.keyCode == record.code && press.upUs < 0) {
+            return &press;
+        }
+    }
+    return nullptr;
+}
+
+void ScriptEncoder::finish(std::string &out) { emitCompleted(out, true); }
+
+void ScriptEncoder::emitCompleted(std::string &out, bool force) {
+    if (!overlapping) {
+        while (!pending.empty() && (force || pending.front().upUs >= 0)) {
+            const PendingPress &press = pending.front();
+            emit(press, press.upUs >= 0 ? press.upUs : press.downUs, out);
+            pending.pop_front();
+        }
+        return;
+    }
+
+    // Overlapping presses are written once none of their keys is down any more.
+    for (const auto &press : pending) {
+        if (press.upUs < 0 && !force) {
+            return;
+        }
+    }
+    emitOverlapping(out);
+    pending.clear();
+    overlapping = false;
+}
+
+std::string ScriptEncoder::getKeyName(int keyCode) const {
+    std::string keyName = keyMap.getKeyName(keyCode);
+    return keyName.empty() ? "KEY_UNKNOWN_" + std::to_string(keyCode) : keyName;
+}
+
+void ScriptEncoder::emitWait(int64_t timestampUs, std::string &out) {
+    if (lastTransitionUs >= 0) {
+        int64_t gapMs = (timestampUs - lastTransitionUs) / 1000;
+        if (gapMs > 0) {
+            out += "wait " + std::to_string(gapMs) + "ms\n";
+        }
+    }
+    lastTransitionUs = timestampUs;
+}
+
+void ScriptEncoder::emit(const PendingPress &press, int64_t endUs, std::string &out) {
+    emitWait(press.downUs, out);
+    std::string keyName = getKeyName(press.keyCode);
+
+    int64_t heldMs = (endUs - press.downUs) / 1000;
+    // Autorepeat only happens while a key is held, so any repeat marks the press as a hold.
+    bool isHold = heldMs >= HoldThresholdMs || press.repeats > 0;
+    std::string command =
+        isHold ? "key_hold " + keyName + " " + std::to_string(heldMs) + "ms" : "key_press " + keyName;
+    // Keep the observed autorepeat timing, so replays scroll like the original remote did.
+    if (press.repeats > 0) {
+        command += " repeat " + std::to_string((press.firstRepeatUs - press.downUs) / 1000) + "ms";
+        if (press.repeats > 1) {
+            int64_t periodMs = (press.lastRepeatUs - press.firstRepeatUs) / (press.repeats - 1) / 1000;
+            command += " " + std::to_string(periodMs > 0 ? periodMs : 1) + "ms";
+        }
+    }
+    emitCommand(command, out);
+}
+
+void ScriptEncoder::emitOverlapping(std::string &out) {
+    struct Transition {
+        int64_t timestampUs;
+        bool down;
+        int keyCode;
+    };
+
+    // Keys still down when the presses are forced out are released with the last transition.
+    int64_t lastUs = 0;
+    for (const auto &press : pending) {
+        lastUs = std::max(lastUs, std::max(press.downUs, press.upUs));
+    }
+    std::vector<Transition> transitions;
+    for (const auto &press : pending) {
+        transitions.push_back({press.downUs, true, press.keyCode});
+        transitions.push_back({press.upUs >= 0 ? press.upUs : lastUs, false, press.keyCode});
+    }
+    std::stable_sort(transitions.begin(), transitions.end(), [](const Transition &a, const Transition &b) {
+        return a.timestampUs < b.timestampUs || (a.timestampUs == b.timestampUs && a.down && !b.down);
+    });
+
+    // Keys that go down or up at the same time are sent together, as one report.
+    for (size_t i = 0; i < transitions.size();) {
+        emitWait(transitions[i].timestampUs, out);
+        std::string command = transitions[i].down ? "key_down" : "key_up";
+        size_t end = i;
+        for (; end < transitions.size() && transitions[end].timestampUs == transitions[i].timestampUs &&
+               transitions[end].down == transitions[i].down;
+             ++end) {
+            command += " " + getKeyName(transitions[end].keyCode);
+        }
+        emitCommand(command, out);
+        i = end;
+    }
+}
+
+void ScriptEncoder::emitCommand(const std::string &command, std::string &out) {
+    if (logCommands) {
+        logInfo("Recorded key event: " + command);
+    }
+
+    out += command;
+    out += '\n';
+}
@@ -0,0 +1,245 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptRunner.h"
+#include "Checkpoint.h"
+#include "CommandHandler.h"
+#include "FileWatcher.h"
+#include "Logger.h"
+#include "Scheduler.h"
+#include "ScriptAnalyzer.h"
+#include "ScriptSharder.h"
+#include "ScriptTask.h"
+#include "SimulatedOutput.h"
+#include "Timeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+/**
+ * Creates the timeline a script starts with, in virtual time from a start if simulated.
+ */
+Timeline createTimeline(double speed, const std::shared_ptr<SimulatedOutput> &simulation,
+                        Timeline::Clock::time_point simulatedStart) {
+    Timeline timeline(speed);
+    if (simulation) {
+        timeline.simulate(simulation, simulatedStart);
+    }
+    return timeline;
+}
+} // namespace
+
+ScriptRunner::ScriptRunner(RunOptions options, size_t outputDevice)
+    : options(std::move(options)), outputDevice(outputDevice) {}
+
+ScriptResult ScriptRunner::run(const std::string &commandsFile) const { return run(commandsFile, nullptr); }
+
+void ScriptRunner::watch(const std::string &commandsFile, const std::atomic<bool> &stop) const {
+    // Watched from the start, so that a save during the first run is not missed
+    FileWatcher watcher;
+    watcher.watch({commandsFile});
+    while (!stop) {
+        std::vector<std::string> files;
+        ScriptResult result = run(commandsFile, &files);
+        std::string line = commandsFile + " (" + std::to_string(result.durationMs) + "ms)";
+        if (result.succeeded) {
+            logInfo("PASS " + line);
+        } else {
+            logError("FAIL " + line);
+        }
+
+        // Changes to files that were already watched during the run are still reported
+        watcher.watch(files);
+        logInfo("Watching " + std::to_string(files.size()) + " file(s) for changes.");
+        std::string changed = watcher.waitForChange(stop);
+        if (!changed.empty()) {
+            logInfo(changed + " changed; running " + commandsFile + " again.");
+        }
+    }
+}
+
+ScriptResult ScriptRunner::run(const std::string &commandsFile, std::vector<std::string> *files) const {
+    ScriptResult result;
+    result.commandsFile = commandsFile;
+    auto start = options.simulation ? options.simulation->getStart() : Timeline::Clock::now();
+    ScriptTask task(createTimeline(options.speed, options.simulation, start), options.intervalMs, outputDevice);
+
+    try {
+        task.getCommandExecutor()->setParsedCommands(CommandHandler::parseCommands(commandsFile, files));
+        setUpCheckpoints(task, commandsFile, options);
+        task.run();
+        result.succeeded = task.succeeded();
+        result.error = task.getError();
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+    if (!result.succeeded) {
+        logError("Error during execution: " + result.error);
+    }
+
+    result.durationMs = task.getElapsedMs();
+    return result;
+}
+
+std::vector<ScriptResult> ScriptRunner::runParallel(const std::vector<std::string> &commandsFiles, size_t workers,
+                                                    const RunOptions &options) {
+    const std::shared_ptr<SimulatedOutput> &simulation = options.simulation;
+    std::vector<ScriptResult> results;
+    std::vector<Job> jobs = createJobs(commandsFiles, workers, options, results);
+    std::vector<std::unique_ptr<ScriptTask>> tasks(jobs.size());
+    std::vector<size_t> taskDevices(jobs.size());
+    std::vector<Timeline::Clock::time_point> deviceFreeAt(std::min(workers, jobs.size()),
+                                                          simulation ? simulation->getStart() : Timeline::Clock::now());
+
+    std::vector<size_t> freeDevices;
+    for (size_t device = deviceFreeAt.size(); device > 0; --device) {
+        freeDevices.push_back(device - 1);
+    }
+
+    // Scripts spend nearly all their time waiting, so a few threads can run all of them.
+    size_t threads = std::max<size_t>(1, std::min<size_t>(freeDevices.size(), std::thread::hardware_concurrency()));
+    Scheduler scheduler(threads);
+
+    std::mutex mutex;
+    std::condition_variable finishedCondition;
+    std::vector<size_t> finishedJobs;
+    size_t nextJob = 0;
+    size_t running = 0;
+
+    for (;;) {
+        while (nextJob < jobs.size() && !freeDevices.empty()) {
+            size_t job = nextJob++;
+            size_t device = freeDevices.back();
+            ScriptResult &result = results[jobs[job].result];
+
+            auto start = simulation ? deviceFreeAt[device] : Timeline::Clock::now();
+            tasks[job] = std::make_unique<ScriptTask>(createTimeline(options.speed, simulation, start),
+                                                      options.intervalMs, device, result.getName());
+            try {
+                tasks[job]->getCommandExecutor()->setParsedCommands(jobs[job].commands);
+                setUpCheckpoints(*tasks[job], result.getName(), options);
+            } catch (const std::exception &e) {
+                result.error = e.what();
+                tasks[job].reset();
+                continue;
+            }
+
+            logInfo("Starting " + result.getName() + " on output device " + std::to_string(device));
+            freeDevices.pop_back();
+            taskDevices[job] = device;
+            ++running;
+            tasks[job]->start(scheduler, [&, job](ScriptTask &) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finishedJobs.push_back(job);
+                finishedCondition.notify_one();
+            });
+        }
+
+        if (running == 0) {
+            break;
+        }
+
+        std::vector<size_t> finished;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finishedCondition.wait(lock, [&]() { return !finishedJobs.empty(); });
+            finished.swap(finishedJobs);
+        }
+
+        for (size_t job : finished) {
+            ScriptResult &result = results[jobs[job].result];
+            result.succeeded = tasks[job]->succeeded();
+            result.error = tasks[job]->getError();
+            result.durationMs = tasks[job]->getElapsedMs();
+            deviceFreeAt[taskDevices[job]] = tasks[job]->getTimeline().now();
+            tasks[job].reset();
+            freeDevices.push_back(taskDevices[job]);
+            --running;
+        }
+    }
+
+    return results;
+}
+
+std::vector<ScriptRunner::Job> ScriptRunner::createJobs(const std::vector<std::string> &commandsFiles, size_t workers,
+                                                       const RunOptions &options, std::vector<ScriptResult> &results) {
+    std::vector<Job> jobs;
+    for (const auto &file : commandsFiles) {
+        std::vector<ScriptSharder::Commands> shards;
+        try {
+            ScriptSharder::Commands commands = CommandHandler::parseCommands(file);
+            if (options.shard) {
+                shards = ScriptSharder::split(commands, workers);
+            } else {
+                shards.push_back(std::move(commands));
+            }
+        } catch (const std::exception &e) {
+            ScriptResult result;
+            result.commandsFile = file;
+            result.error = e.what();
+            results.push_back(result);
+            continue;
+        }
+
+        for (size_t i = 0; i < shards.size(); ++i) {
+            ScriptResult result;
+            result.commandsFile = file;
+            result.shard = options.shard ? i + 1 : 0;
+            results.push_back(result);
+            jobs.push_back({results.size() - 1, std::move(shards[i]), 0});
+        }
+        if (options.shard) {
+            logInfo("Split " + file + " into " + std::to_string(shards.size()) + " shards.");
+        }
+    }
+
+    // Starting the longest shards first keeps the devices busy until the end. The estimates
+    // come from simulating each shard, which takes no time.
+    if (options.shard && jobs.size() > 1) {
+        ScriptAnalyzer analyzer(options.intervalMs, options.speed);
+        for (Job &job : jobs) {
+            job.estimatedMs = analyzer.analyze(results[job.result].getName(), job.commands).durationMs;
+        }
+        std::stable_sort(jobs.begin(), jobs.end(),
+                         [](const Job &a, const Job &b) { return a.estimatedMs > b.estimatedMs; });
+    }
+    return jobs;
+}
+
+void ScriptRunner::setUpCheckpoints(ScriptTask &task, const std::string &commandsFile, const RunOptions &options) {
+    if (!options.checkpoints) {
+        return;
+    }
+
+    std::string checkpointFile = options.checkpointFile.empty() ? commandsFile + ".checkpoint" : options.checkpointFile;
+    if (options.resume) {
+        Checkpoint checkpoint;
+        if (Checkpoint::load(checkpointFile, checkpoint)) {
+            task.restore(checkpoint);
+        } else {
+            logInfo("No checkpoint at " + checkpointFile + "; starting from the beginning.");
+        }
+    }
+    task.enableCheckpoints(checkpointFile);
+}
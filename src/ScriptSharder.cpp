@@ -0,0 +1,126 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptSharder.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+std::vector<ScriptSharder::Commands> ScriptSharder::split(const Commands &commands, size_t maxShards) {
+    std::vector<size_t> markers;
+    int depth = 0;
+
+    for (size_t index = 0; index < commands.size(); ++index) {
+        const std::string &command = commands[index][0];
+        if (command == "loop_start" || command == "parallel_start") {
+            ++depth;
+        } else if (command == "loop_end" || command == "parallel_end") {
+            depth = std::max(0, depth - 1);
+        } else if (command == "shard") {
+            if (depth > 0) {
+                throw std::runtime_error("The shard marker at command " + std::to_string(index + 1) +
+                                         " is inside a loop or parallel block.");
+            }
+            markers.push_back(index);
+        }
+    }
+
+    return markers.empty() ? splitLoop(commands, std::max<size_t>(1, maxShards)) : splitAtMarkers(commands, markers);
+}
+
+std::vector<ScriptSharder::Commands> ScriptSharder::splitAtMarkers(const Commands &commands,
+                                                                   const std::vector<size_t> &markers) {
+    Commands prelude(commands.begin(), commands.begin() + markers.front());
+    std::vector<Commands> shards;
+
+    for (size_t i = 0; i < markers.size(); ++i) {
+        size_t end = i + 1 < markers.size() ? markers[i + 1] : commands.size();
+        if (end == markers[i] + 1) {
+            continue;
+        }
+
+        Commands shard = prelude;
+        shard.insert(shard.end(), commands.begin() + markers[i] + 1, commands.begin() + end);
+        shards.push_back(std::move(shard));
+    }
+
+    if (shards.empty()) {
+        throw std::runtime_error("The script has shard markers but no commands after them.");
+    }
+    logDebug("Split script at " + std::to_string(markers.size()) + " shard markers into " +
+             std::to_string(shards.size()) + " shards.");
+    return shards;
+}
+
+std::vector<ScriptSharder::Commands> ScriptSharder::splitLoop(const Commands &commands, size_t maxShards) {
+    size_t loopStart = commands.size();
+    size_t loopEnd = commands.size();
+    std::vector<size_t> blocks; // Start of each open block, outermost first
+
+    // The last top-level loop is split; everything before it is the prelude of every shard.
+    for (size_t index = 0; index < commands.size(); ++index) {
+        const std::string &command = commands[index][0];
+        if (command == "loop_start" || command == "parallel_start") {
+            blocks.push_back(index);
+        } else if ((command == "loop_end" || command == "parallel_end") && !blocks.empty()) {
+            size_t start = blocks.back();
+            blocks.pop_back();
+            if (blocks.empty() && command == "loop_end" && commands[start][0] == "loop_start") {
+                loopStart = start;
+                loopEnd = index;
+            }
+        }
+    }
+
+    if (loopEnd == commands.size()) {
+        throw std::runtime_error("The script has no shard markers and no top-level loop to split.");
+    }
+    if (loopEnd + 1 != commands.size()) {
+        throw std::runtime_error("Commands follow the top-level loop ending at command " + std::to_string(loopEnd + 1) +
+                                 "; mark the shards with shard instead.");
+    }
+
+    const auto &loopCommand = commands[loopStart];
+    int count = 0;
+    try {
+        count = loopCommand.size() == 2 ? std::stoi(loopCommand[1]) : 0;
+    } catch (const std::exception &) {
+        count = 0;
+    }
+    if (count <= 0) {
+        throw std::runtime_error("The top-level loop at command " + std::to_string(loopStart + 1) +
+                                 " needs a literal count to be split.");
+    }
+
+    size_t total = static_cast<size_t>(count);
+    size_t shardCount = std::min(maxShards, total);
+    std::vector<Commands> shards;
+    for (size_t i = 0; i < shardCount; ++i) {
+        size_t iterations = total / shardCount + (i < total % shardCount ? 1 : 0);
+
+        Commands shard(commands.begin(), commands.begin() + loopStart);
+        shard.push_back({"loop_start", std::to_string(iterations)});
+        shard.insert(shard.end(), commands.begin() + loopStart + 1, commands.end());
+        shards.push_back(std::move(shard));
+    }
+
+    logDebug("Split " + std::to_string(count) + " loop iterations into " + std::to_string(shardCount) + " shards.");
+    return shards;
+}
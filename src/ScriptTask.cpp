@@ -0,0 +1,282 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptTask.h"
+#include "AppExecutor.h"
+#include "KeyPressExecutor.h"
+#include "Logger.h"
+#include "LoopExecutor.h"
+#include "VariableExecutor.h"
+#include "WaitExecutor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+
+ScriptTask::ScriptTask(const Timeline &timeline, int intervalMs, size_t outputDevice, std::string logContext,
+                       Variables variables)
+    : variables(std::move(variables)), timeline(timeline), keyManager(intervalMs, outputDevice),
+      executor(std::make_shared<CommandExecutor>(this->variables)),
+      loopExecutor(std::make_shared<LoopExecutor>(executor)), intervalMs(intervalMs), outputDevice(outputDevice),
+      logContext(std::move(logContext)), startedAt(this->timeline.now()) {
+    this->timeline.setWaker([this]() { wake(); });
+
+    executor->registerCommand("var", std::make_shared<VariableExecutor>(this->variables));
+
+    auto keyPressExecutor = std::make_shared<KeyPressExecutor>(keyManager, this->timeline);
+    executor->registerCommand("key_press", keyPressExecutor);
+    executor->registerCommand("key_hold", keyPressExecutor);
+    executor->registerCommand("key_down", keyPressExecutor);
+    executor->registerCommand("key_up", keyPressExecutor);
+    executor->registerCommand("key_combo", keyPressExecutor);
+    executor->registerCommand("type_text", keyPressExecutor);
+
+    executor->registerCommand("loop_start", loopExecutor);
+    executor->registerCommand("loop_end", loopExecutor);
+
+    auto parallelExecutor = std::make_shared<ParallelExecutor>(
+        executor, [this](std::vector<ParallelExecutor::Commands> commands) { runBranches(std::move(commands)); });
+    executor->registerCommand("parallel_start", parallelExecutor);
+    executor->registerCommand("branch", parallelExecutor);
+    executor->registerCommand("parallel_end", parallelExecutor);
+    executor->registerCommand("shard", parallelExecutor);
+
+    auto appExecutor = std::make_shared<AppExecutor>(this->timeline);
+    executor->registerCommand("launch_app", appExecutor);
+    executor->registerCommand("close_app", appExecutor);
+
+    auto waitExecutor = std::make_shared<WaitExecutor>(this->timeline);
+    executor->registerCommand("wait", waitExecutor);
+    executor->registerCommand("timeline", waitExecutor);
+    executor->registerCommand("wait_for_key", waitExecutor);
+    executor->registerCommand("wait_for_log", waitExecutor);
+}
+
+std::shared_ptr<CommandExecutor> ScriptTask::getCommandExecutor() const { return executor; }
+
+const Timeline &ScriptTask::getTimeline() const { return timeline; }
+
+void ScriptTask::setMinLogLevel(LogLevel level) { minLogLevel = level; }
+
+void ScriptTask::enableCheckpoints(std::string filePath) {
+    checkpointPath = std::move(filePath);
+    checkpointScriptHash = Checkpoint::hashCommands(executor->getParsedCommands());
+    lastCheckpoint = timeline.now();
+}
+
+void ScriptTask::restore(const Checkpoint &checkpoint) {
+    const auto &commands = executor->getParsedCommands();
+    if (checkpoint.scriptHash != Checkpoint::hashCommands(commands)) {
+        throw std::runtime_error("The checkpoint was written for different commands; the commands file has changed.");
+    }
+
+    executor->setCommandIndex(checkpoint.commandIndex);
+    loopExecutor->setLoops(checkpoint.loops);
+    variables = checkpoint.variables;
+    timeline.setMode(checkpoint.mode);
+    keyManager.pressHeldKeys(timeline, checkpoint.heldKeys);
+    restoredElapsedMs = checkpoint.elapsedMs;
+
+    logInfo("Resuming at command " + std::to_string(checkpoint.commandIndex + 1) + " of " +
+            std::to_string(commands.size()) + " after " + std::to_string(checkpoint.elapsedMs) +
+            "ms of script time.");
+}
+
+int64_t ScriptTask::getElapsedMs() const {
+    return restoredElapsedMs +
+           std::chrono::duration_cast<std::chrono::milliseconds>(timeline.now() - startedAt).count();
+}
+
+void ScriptTask::run() {
+    setLogContext(logContext, minLogLevel);
+    try {
+        Timeline::Clock::time_point wakeAt;
+        while (advance(wakeAt) != State::Finished) {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            if (wakeAt == Timeline::Clock::time_point::max()) {
+                wakeCondition.wait(lock, [this]() { return woken; });
+            } else {
+                wakeCondition.wait_until(lock, wakeAt, [this]() { return woken; });
+            }
+            woken = false;
+        }
+        success = true;
+    } catch (const std::exception &e) {
+        fail(e.what());
+    }
+}
+
+void ScriptTask::start(Scheduler &scheduler, FinishedCallback onFinished) {
+    this->scheduler = &scheduler;
+    this->onFinished = std::move(onFinished);
+    scheduler.schedule(*this);
+}
+
+bool ScriptTask::succeeded() const { return success; }
+
+const std::string &ScriptTask::getError() const { return error; }
+
+void ScriptTask::resume(Scheduler &scheduler) {
+    setLogContext(logContext, minLogLevel);
+    try {
+        Timeline::Clock::time_point wakeAt;
+        switch (advance(wakeAt)) {
+        case State::Waiting:
+            scheduler.schedule(*this, wakeAt);
+            return;
+        case State::Joining:
+            // The last branch to finish resumes the task, possibly already on another worker.
+            return;
+        case State::Finished:
+            success = true;
+            break;
+        }
+    } catch (const std::exception &e) {
+        fail(e.what());
+    }
+
+    // The callback may destroy the task, so it must not run from the member.
+    FinishedCallback finished = std::move(onFinished);
+    finished(*this);
+}
+
+ScriptTask::State ScriptTask::advance(Timeline::Clock::time_point &wakeAt) {
+    for (;;) {
+        if (!branches.empty() && runningBranches == 0) {
+            joinBranches();
+        }
+
+        timeline.dispatchDue();
+        if (timeline.hasPending()) {
+            wakeAt = timeline.nextDue();
+            return State::Waiting;
+        }
+
+        writeCheckpoint();
+        if (!executor->step()) {
+            if (keyManager.releaseHeldKeys(timeline)) {
+                continue;
+            }
+            if (!checkpointPath.empty()) {
+                std::remove(checkpointPath.c_str());
+            }
+            return State::Finished;
+        }
+
+        // Drop the task's own hold on a block it started; whoever drops the last one continues.
+        if (!branches.empty() && --runningBranches > 0) {
+            return State::Joining;
+        }
+    }
+}
+
+void ScriptTask::runBranches(std::vector<ParallelExecutor::Commands> commands) {
+    for (size_t i = 0; i < commands.size(); ++i) {
+        std::string branchContext = (logContext.empty() ? "" : logContext + " ") + "branch " + std::to_string(i + 1);
+        branches.push_back(
+            std::make_unique<ScriptTask>(timeline, intervalMs, outputDevice, std::move(branchContext), variables));
+        branches.back()->minLogLevel = minLogLevel;
+        branches.back()->executor->setParsedCommands(commands[i]);
+    }
+
+    if (!scheduler) {
+        std::vector<std::thread> threads;
+        for (auto &branch : branches) {
+            threads.emplace_back([&branch]() { branch->run(); });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        runningBranches = 1;
+        return;
+    }
+
+    runningBranches = branches.size() + 1;
+    for (auto &branch : branches) {
+        branch->start(*scheduler, [this](ScriptTask &) {
+            if (--runningBranches == 0) {
+                scheduler->schedule(*this);
+            }
+        });
+    }
+}
+
+void ScriptTask::wake() {
+    if (scheduler) {
+        scheduler->wake(*this);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        woken = true;
+    }
+    wakeCondition.notify_one();
+}
+
+void ScriptTask::joinBranches() {
+    std::vector<std::unique_ptr<ScriptTask>> finished = std::move(branches);
+    branches.clear();
+
+    // A simulated block ends when its longest branch does, as a real one would.
+    for (const auto &branch : finished) {
+        timeline.catchUp(branch->timeline.now());
+    }
+
+    for (size_t i = 0; i < finished.size(); ++i) {
+        if (!finished[i]->succeeded()) {
+            throw std::runtime_error("Parallel branch " + std::to_string(i + 1) + " failed: " +
+                                     finished[i]->getError());
+        }
+    }
+    logDebug("Parallel block joined.");
+}
+
+void ScriptTask::writeCheckpoint() {
+    if (checkpointPath.empty() || timeline.now() - lastCheckpoint < std::chrono::milliseconds(CheckpointIntervalMs) ||
+        executor->getCurrentCommandIndex() >= executor->getParsedCommands().size()) {
+        return;
+    }
+    lastCheckpoint = timeline.now();
+
+    Checkpoint checkpoint;
+    checkpoint.scriptHash = checkpointScriptHash;
+    checkpoint.commandIndex = executor->getCurrentCommandIndex();
+    checkpoint.elapsedMs = getElapsedMs();
+    checkpoint.mode = timeline.getMode();
+    checkpoint.loops = loopExecutor->getLoops();
+    checkpoint.heldKeys = keyManager.getHeldKeys();
+    checkpoint.variables = variables;
+
+    try {
+        checkpoint.save(checkpointPath);
+        logDebug("Checkpoint written at command " + std::to_string(checkpoint.commandIndex + 1) + ".");
+    } catch (const std::exception &e) {
+        logWarn(e.what());
+    }
+}
+
+void ScriptTask::fail(const std::string &reason) {
+    error = reason;
+    // The key manager releases held keys on the device when it is destroyed; a simulated
+    // device only sees the release if it is scheduled here.
+    if (timeline.isSimulated() && keyManager.releaseHeldKeys(timeline)) {
+        timeline.dispatchDue();
+    }
+}
@@ -0,0 +1,110 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "SimulatedOutput.h"
+#include "KeyMap.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+
+SimulatedOutput::SimulatedOutput(bool keepTrace) : start(Timeline::Clock::now()), keepTrace(keepTrace) {}
+
+Timeline::Clock::time_point SimulatedOutput::getStart() const { return start; }
+
+void SimulatedOutput::send(Timeline::Clock::time_point due, size_t outputDevice,
+                           const std::vector<KeyEvent> &reportEvents) {
+    int64_t timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(due - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    eventCount += reportEvents.size();
+    endUs = std::max(endUs, timestampUs);
+    if (!keepTrace) {
+        return;
+    }
+    for (const KeyEvent &event : reportEvents) {
+        if (events.size() == MaxTraceEvents) {
+            logWarn("More than " + std::to_string(MaxTraceEvents) +
+                    " simulated events; the trace ends with the first of them.");
+            keepTrace = false;
+            return;
+        }
+        events.push_back({timestampUs, outputDevice, event});
+    }
+}
+
+void SimulatedOutput::countAppAction() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++appActions;
+}
+
+size_t SimulatedOutput::getEventCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return eventCount;
+}
+
+size_t SimulatedOutput::getAppActionCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return appActions;
+}
+
+void SimulatedOutput::logSummary() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    logInfo("Simulated " + std::to_string(eventCount) + " key events and " + std::to_string(appActions) +
+            " app actions; the last event is at " + std::to_string(endUs / 1000) + "ms of script time.");
+}
+
+void SimulatedOutput::writeTrace(const std::string &outputFile, RecordFormat format) const {
+    std::vector<SentEvent> timeline;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        timeline = events;
+    }
+    // Parallel branches are simulated one after another, so their events are merged by time.
+    std::stable_sort(timeline.begin(), timeline.end(),
+                     [](const SentEvent &a, const SentEvent &b) { return a.timestampUs < b.timestampUs; });
+
+    KeyMap keyMap;
+    RecordWriter writer(keyMap);
+    writer.start(outputFile, format);
+
+    std::vector<bool> announced;
+    for (const SentEvent &sent : timeline) {
+        if (sent.outputDevice >= announced.size()) {
+            announced.resize(sent.outputDevice + 1, false);
+        }
+        if (!announced[sent.outputDevice]) {
+            writer.addDevice(static_cast<uint16_t>(sent.outputDevice),
+                             "otto simulated device " + std::to_string(sent.outputDevice));
+            announced[sent.outputDevice] = true;
+        }
+
+        InputRecord record{};
+        record.timestampUs = sent.timestampUs;
+        record.deviceId = static_cast<uint16_t>(sent.outputDevice);
+        record.type = INPUT_TYPE_KEY;
+        record.code = static_cast<uint16_t>(sent.event.keyCode);
+        record.value = sent.event.keyType == static_cast<int>(KET_KEYDOWN)     ? INPUT_PRESS
+                       : sent.event.keyType == static_cast<int>(KET_KEYREPEAT) ? INPUT_REPEAT
+                                                                                : INPUT_RELEASE;
+        writer.pushWaiting(record);
+    }
+
+    writer.stop();
+}
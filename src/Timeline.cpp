@@ -0,0 +1,150 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Timeline.h"
+#include "EventManager.h"
+#include "Logger.h"
+#include "SimulatedOutput.h"
+
+#include <regex>
+
+Timeline::Signal::Signal(std::function<void()> waker) : waker(std::move(waker)) {}
+
+void Timeline::Signal::notify() {
+    if (!notified.exchange(true) && waker) {
+        waker();
+    }
+}
+
+bool Timeline::Signal::isNotified() const { return notified; }
+
+Timeline::Timeline(double speed) : speed(speed) {}
+
+void Timeline::setMode(Mode newMode) {
+    mode = newMode;
+    if (mode == Mode::Absolute) {
+        deadline = now();
+    }
+    logDebug(std::string("Timeline mode set to ") + (mode == Mode::Absolute ? "absolute." : "relative."));
+}
+
+Timeline::Mode Timeline::getMode() const { return mode; }
+
+void Timeline::wait(int durationMs) {
+    auto scaled = std::chrono::microseconds(static_cast<long long>(durationMs * 1000.0 / speed));
+
+    if (mode == Mode::Relative) {
+        schedule(now() + scaled);
+        return;
+    }
+
+    deadline += scaled;
+    auto current = now();
+    if (deadline < current) {
+        logDebug("Timeline behind schedule by " +
+                 std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(current - deadline).count()) +
+                 "ms.");
+    }
+    schedule(deadline);
+}
+
+Timeline::Clock::time_point Timeline::now() const { return simulatedOutput ? simulatedNow : Clock::now(); }
+
+void Timeline::simulate(std::shared_ptr<SimulatedOutput> output, Clock::time_point start) {
+    simulatedOutput = std::move(output);
+    simulatedNow = start;
+    deadline = start;
+}
+
+const std::shared_ptr<SimulatedOutput> &Timeline::getSimulatedOutput() const { return simulatedOutput; }
+
+bool Timeline::isSimulated() const { return simulatedOutput != nullptr; }
+
+void Timeline::catchUp(Clock::time_point time) {
+    if (simulatedOutput && time > simulatedNow) {
+        simulatedNow = time;
+    }
+}
+
+void Timeline::schedule(Clock::time_point due, size_t outputDevice, std::vector<KeyEvent> events) {
+    pending.push_back({due, outputDevice, std::move(events), nullptr, nullptr});
+}
+
+void Timeline::setWaker(std::function<void()> newWaker) { waker = std::move(newWaker); }
+
+std::shared_ptr<Timeline::Signal> Timeline::await(Clock::time_point timeout, std::function<void(bool)> done) {
+    auto signal = std::make_shared<Signal>(waker);
+    pending.push_back({timeout, 0, {}, signal, std::move(done)});
+    return signal;
+}
+
+bool Timeline::hasPending() const { return !pending.empty(); }
+
+Timeline::Clock::time_point Timeline::nextDue() const { return pending.front().due; }
+
+void Timeline::dispatchDue() {
+    auto current = now();
+    while (!pending.empty()) {
+        TimedReport &report = pending.front();
+        bool signalled = report.signal && (report.signal->isNotified() || simulatedOutput);
+        if (!signalled && report.due > current) {
+            if (!simulatedOutput) {
+                break;
+            }
+            current = simulatedNow = report.due;
+        }
+
+        if (!report.events.empty()) {
+            if (simulatedOutput) {
+                simulatedOutput->send(current, report.outputDevice, report.events);
+            } else {
+                EventManager::getInstance().sendEvents(report.events, report.outputDevice);
+            }
+        }
+        auto done = std::move(report.done);
+        pending.pop_front();
+        if (done) {
+            done(signalled);
+        }
+    }
+}
+
+int Timeline::scale(int durationMs) const { return static_cast<int>(durationMs / speed); }
+
+double Timeline::getSpeed() const { return speed; }
+
+int Timeline::parseDuration(const std::string &durationStr) {
+    static const std::regex durationRegex(R"(^(\d+)(ms|s|m)$)");
+    std::smatch match;
+
+    if (std::regex_match(durationStr, match, durationRegex)) {
+        int value = std::stoi(match[1].str());
+        const std::string &unit = match[2].str();
+
+        if (unit == "ms") {
+            return value;
+        } else if (unit == "s") {
+            return value * 1000;
+        } else if (unit == "m") {
+            return value * 60 * 1000;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,136 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "VirtualInputDevice.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+static bool isBitSet(const uint8_t *bits, size_t bit) { return bits[bit / 8] & (1u << (bit % 8)); }
+
+VirtualInputDevice::VirtualInputDevice(const std::string &name, const CaptureDeviceCapabilities &capabilities) {
+    fd = open("/dev/uinput", O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open /dev/uinput");
+    }
+
+    // The name keeps otto's prefix, so replayed events are never captured again.
+    deviceName = "OttoUInput " + name;
+
+    // EV_REP is left out: captured autorepeat events are replayed as they were recorded, and the
+    // kernel must not add its own. Types without capability bits here (LEDs, sound, force
+    // feedback) are outputs of the device and are not replayed.
+    const int replayedTypes[] = {EV_SYN, EV_KEY, EV_REL, EV_ABS, EV_MSC};
+    for (int type : replayedTypes) {
+        if (capabilities.eventTypes & (1u << type)) {
+            ioctl(fd, UI_SET_EVBIT, type);
+        }
+    }
+
+    for (size_t code = 0; code < CaptureDeviceCapabilities::KeyCount; ++code) {
+        if (isBitSet(capabilities.keyBits, code)) {
+            ioctl(fd, UI_SET_KEYBIT, code);
+        }
+    }
+    for (size_t code = 0; code < CaptureDeviceCapabilities::RelCount; ++code) {
+        if (isBitSet(capabilities.relBits, code)) {
+            ioctl(fd, UI_SET_RELBIT, code);
+        }
+    }
+    for (size_t code = 0; code < CaptureDeviceCapabilities::MscCount; ++code) {
+        if (isBitSet(capabilities.mscBits, code)) {
+            ioctl(fd, UI_SET_MSCBIT, code);
+        }
+    }
+    for (size_t code = 0; code < CaptureDeviceCapabilities::PropCount; ++code) {
+        if (isBitSet(capabilities.propBits, code)) {
+            ioctl(fd, UI_SET_PROPBIT, code);
+        }
+    }
+    for (size_t code = 0; code < CaptureDeviceCapabilities::AbsCount; ++code) {
+        if (!isBitSet(capabilities.absBits, code)) {
+            continue;
+        }
+        struct uinput_abs_setup absSetup {};
+        absSetup.code = static_cast<uint16_t>(code);
+        absSetup.absinfo.minimum = capabilities.absInfo[code].minimum;
+        absSetup.absinfo.maximum = capabilities.absInfo[code].maximum;
+        absSetup.absinfo.fuzz = capabilities.absInfo[code].fuzz;
+        absSetup.absinfo.flat = capabilities.absInfo[code].flat;
+        absSetup.absinfo.resolution = capabilities.absInfo[code].resolution;
+        ioctl(fd, UI_SET_ABSBIT, code);
+        if (ioctl(fd, UI_ABS_SETUP, &absSetup) < 0) {
+            logWarn("Failed to set up axis " + std::to_string(code) + " for virtual device: " + deviceName);
+        }
+    }
+
+    struct uinput_setup setup {};
+    setup.id.bustype = capabilities.bustype;
+    setup.id.vendor = capabilities.vendor;
+    setup.id.product = capabilities.product;
+    setup.id.version = capabilities.version;
+    strncpy(setup.name, deviceName.c_str(), sizeof(setup.name) - 1);
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0 || ioctl(fd, UI_DEV_CREATE) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to create virtual input device: " + deviceName);
+    }
+
+    frame.reserve(64);
+    logInfo("Created virtual input device: " + deviceName);
+}
+
+VirtualInputDevice::~VirtualInputDevice() {
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    logDebug("Destroyed virtual input device: " + deviceName);
+}
+
+bool VirtualInputDevice::append(const InputRecord &record) {
+    // A dropped-events marker describes the capture, not the device; replaying it would make
+    // readers discard state.
+    if (record.type == EV_SYN && record.code == SYN_DROPPED) {
+        return false;
+    }
+
+    struct input_event event {};
+    event.type = record.type;
+    event.code = record.code;
+    event.value = record.value;
+    frame.push_back(event);
+    return record.type == EV_SYN && record.code == SYN_REPORT;
+}
+
+bool VirtualInputDevice::writeFrame() {
+    size_t size = frame.size() * sizeof(struct input_event);
+    ssize_t written = write(fd, frame.data(), size);
+    frame.clear();
+    if (written != static_cast<ssize_t>(size)) {
+        logError("Failed to write event frame to " + deviceName + ": " + std::string(strerror(errno)));
+        return false;
+    }
+    return true;
+}
@@ -18,20 +18,40 @@
 */
 
 #include "WaitExecutor.h"
+#include "EventManager.h"
+#include "LogWatcher.h"
 #include "Logger.h"
 
-#include <chrono>
-#include <regex>
-#include <thread>
+#include <memory>
+#include <stdexcept>
+
+WaitExecutor::WaitExecutor(Timeline &timeline) : timeline(timeline) {}
 
 void WaitExecutor::execute(const std::vector<std::string> &args) {
+    if (!args.empty() && args[0] == "timeline") {
+        if (args.size() != 2 || (args[1] != "absolute" && args[1] != "relative")) {
+            logError("Invalid timeline command format. Usage: timeline <absolute|relative>");
+            return;
+        }
+        timeline.setMode(args[1] == "absolute" ? Timeline::Mode::Absolute : Timeline::Mode::Relative);
+        return;
+    }
+    if (!args.empty() && args[0] == "wait_for_key") {
+        executeWaitForKey(args);
+        return;
+    }
+    if (!args.empty() && args[0] == "wait_for_log") {
+        executeWaitForLog(args);
+        return;
+    }
+
     if (args.size() != 2) {
         logError("Invalid wait command format. Usage: wait <duration>");
         return;
     }
 
     const std::string &durationStr = args[1];
-    int durationMs = parseDuration(durationStr);
+    int durationMs = Timeline::parseDuration(durationStr);
 
     if (durationMs < 0) {
         logError("Invalid duration format: " + durationStr + ". Usage examples: 5s, 2m.");
@@ -39,25 +59,120 @@ void WaitExecutor::execute(const std::vector<std::string> &args) {
     }
 
     logDebug("Waiting for " + std::to_string(durationMs) + " milliseconds.");
-    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+    timeline.wait(durationMs);
 }
 
-int WaitExecutor::parseDuration(const std::string &durationStr) const {
-    std::regex durationRegex(R"(^(\d+)(ms|s|m)$)");
-    std::smatch match;
+void WaitExecutor::executeWaitForKey(const std::vector<std::string> &args) {
+    if (args.size() != 2 && args.size() != 3) {
+        logError("Invalid wait_for_key command format. Usage: wait_for_key <key> [timeout]");
+        return;
+    }
+
+    const std::string &key = args[1];
+    int keyCode = keyMap.getKeyCode(key);
+    if (keyCode == -1) {
+        logError("Invalid key: " + key);
+        return;
+    }
 
-    if (std::regex_match(durationStr, match, durationRegex)) {
-        int value = std::stoi(match[1].str());
-        const std::string &unit = match[2].str();
+    int timeoutMs = parseTimeout(args, 2);
+    if (timeoutMs == -2) {
+        return;
+    }
+    if (timeline.isSimulated()) {
+        logInfo("Simulated key " + key + " pressed at once.");
+        return;
+    }
+
+    auto start = timeline.now();
+    auto timeout = timeoutMs < 0 ? Timeline::Clock::time_point::max() : start + std::chrono::milliseconds(timeoutMs);
+    auto listenerId = std::make_shared<size_t>(0);
 
-        if (unit == "ms") {
-            return value;
-        } else if (unit == "s") {
-            return value * 1000;
-        } else if (unit == "m") {
-            return value * 60 * 1000;
+    auto signal = timeline.await(timeout, [this, key, start, listenerId](bool signalled) {
+        EventManager::getInstance().removeKeyListener(*listenerId);
+        auto waitedMs = std::chrono::duration_cast<std::chrono::milliseconds>(timeline.now() - start).count();
+        if (!signalled) {
+            throw std::runtime_error("Timed out after " + std::to_string(waitedMs) + "ms waiting for key: " + key);
         }
+        logInfo("Key " + key + " pressed after " + std::to_string(waitedMs) + "ms.");
+    });
+
+    logDebug("Waiting for key: " + key);
+    *listenerId = EventManager::getInstance().addKeyListener([signal, keyCode](int keyType, int code) {
+        if (code == keyCode && keyType == static_cast<int>(KET_KEYDOWN)) {
+            signal->notify();
+        }
+    });
+}
+
+void WaitExecutor::executeWaitForLog(const std::vector<std::string> &args) {
+    if (args.size() != 3 && args.size() != 4) {
+        logError("Invalid wait_for_log command format. Usage: wait_for_log <file> <regex> [timeout]");
+        return;
+    }
+
+    const std::string &file = args[1];
+    std::shared_ptr<const std::regex> pattern;
+    try {
+        pattern = getPattern(args[2]);
+    } catch (const std::regex_error &e) {
+        logError("Invalid regex: " + args[2] + " (" + e.what() + ")");
+        return;
     }
 
-    return -1;
+    int timeoutMs = parseTimeout(args, 3);
+    if (timeoutMs == -2) {
+        return;
+    }
+    if (timeline.isSimulated()) {
+        logInfo("Simulated log " + file + " matched at once.");
+        return;
+    }
+
+    auto start = timeline.now();
+    auto timeout = timeoutMs < 0 ? Timeline::Clock::time_point::max() : start + std::chrono::milliseconds(timeoutMs);
+    auto watchId = std::make_shared<size_t>(0);
+    auto matchedLine = std::make_shared<std::string>();
+    auto failure = std::make_shared<std::string>();
+
+    auto signal = timeline.await(timeout, [this, file, start, watchId, matchedLine, failure](bool signalled) {
+        LogWatcher::getInstance().removeWatch(*watchId);
+        auto waitedMs = std::chrono::duration_cast<std::chrono::milliseconds>(timeline.now() - start).count();
+        if (!signalled) {
+            throw std::runtime_error("Timed out after " + std::to_string(waitedMs) + "ms waiting for log: " + file);
+        }
+        if (!failure->empty()) {
+            throw std::runtime_error("Stopped waiting for log " + file + ": " + *failure);
+        }
+        logInfo("Log " + file + " matched after " + std::to_string(waitedMs) + "ms: " + *matchedLine);
+    });
+
+    logDebug("Waiting for /" + args[2] + "/ in log: " + file);
+    // The line is written before notify() and read after the wake-up it causes.
+    auto listener = [signal, matchedLine, failure](bool matched, const std::string &line) {
+        *(matched ? matchedLine : failure) = line;
+        signal->notify();
+    };
+    *watchId = LogWatcher::getInstance().addWatch(file, pattern, listener);
+}
+
+int WaitExecutor::parseTimeout(const std::vector<std::string> &args, size_t index) {
+    if (args.size() <= index) {
+        return -1;
+    }
+    // The timeout bounds how long the system under test may take, so it is not scaled by speed.
+    int timeoutMs = Timeline::parseDuration(args[index]);
+    if (timeoutMs < 0) {
+        logError("Invalid duration format: " + args[index] + ". Usage examples: 5s, 2m.");
+        return -2;
+    }
+    return timeoutMs;
+}
+
+std::shared_ptr<const std::regex> WaitExecutor::getPattern(const std::string &pattern) {
+    auto it = patterns.find(pattern);
+    if (it == patterns.end()) {
+        it = patterns.emplace(pattern, std::make_shared<const std::regex>(pattern, std::regex::optimize)).first;
+    }
+    return it->second;
 }
@@ -17,21 +17,24 @@
 * limitations under the License.
 */
 
-#include "AppExecutor.h"
-#include "CommandExecutor.h"
-#include "CommandHandler.h"
+#include "CaptureFile.h"
+#include "EventManager.h"
 #include "KeyManager.h"
-#include "KeyPressExecutor.h"
+#include "KeyMap.h"
 #include "Logger.h"
-#include "LoopExecutor.h"
-#include "VariableExecutor.h"
-#include "WaitExecutor.h"
+#include "ScriptAnalyzer.h"
+#include "ScriptRunner.h"
+#include "SimulatedOutput.h"
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <csignal>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <thread>
+#include <vector>
 
 std::atomic<bool> isRecordingActive(true);
 
@@ -41,24 +44,71 @@ void handleSignal(int signal) {
     }
 }
 
+std::atomic<bool> stopWatching(false);
+
+void handleWatchSignal(int signal) {
+    // Watching stops once the current run has finished; a second signal ends otto at once.
+    stopWatching = true;
+    std::signal(signal, SIG_DFL);
+}
+
 void printUsage() {
     std::cout << "Usage: ./otto [options]\n"
               << "Options:\n"
-              << "  <commands_file>: Path to the commands file for execution.\n"
+              << "  <commands_file>...: Path to one or more commands files for execution.\n"
+              << "  --parallel=<count>: (Optional) Run commands files concurrently on this many virtual devices.\n"
+              << "      Default: 1 (one after another).\n"
               << "  --intervalMs=<value>: (Optional) Interval between key presses in milliseconds. Default: 100ms.\n"
               << "  --logLevel=<level>: (Optional) Logging level. Values: DEBUG, INFO, WARN, ERROR. Default: INFO.\n"
-              << "  --record=<output_file>: (Optional) Start in record mode and save events to a file.\n";
+              << "  <capture_file>: Path to a binary capture file to replay with its recorded timing.\n"
+              << "  --record=<output_file>: (Optional) Start in record mode and save events to a file.\n"
+              << "  --recordFormat=<format>: (Optional) Record file format. Values: text, binary, raw (binary with every\n"
+              << "      evdev event, e.g. pointer motion and touch). Default: text.\n"
+              << "  --convert=<capture_file> <output_file>: (Optional) Convert a binary capture file to a commands file.\n"
+              << "  --debounceMs=[<device>=]<value>: (Optional) Ignore repeated presses of a key within this window while\n"
+              << "      recording, for all devices or for one device path or name. Can be repeated. Default: 0 (off).\n"
+              << "  --device=[+|-]<field>:<pattern>: (Optional) Include or exclude input devices while recording\n"
+              << "      and for wait_for_key. Fields: name, phys, path (globs), cap (e.g. EV_KEY), key (e.g. power).\n"
+              << "      Can be repeated.\n"
+              << "  --mirror: (Optional) Forward captured key events to the virtual device as they arrive. Can be\n"
+              << "      combined with --record. Reports the capture-to-injection latency on exit.\n"
+              << "  --remap=<from_key>=<to_key>: (Optional) Replace a key while mirroring. Can be repeated.\n"
+              << "  --keymap=<profile_file>: (Optional) Load key names from a key map profile, e.g. for a specific remote.\n"
+              << "  --speed=<factor>: (Optional) Replay speed factor applied to waits and holds. Default: 1.0.\n"
+              << "  --simulate[=<trace_file>]: (Optional) Run commands files in virtual time without sending any events\n"
+              << "      or contacting apps, and optionally write the events they would send to a file in the format\n"
+              << "      selected by --recordFormat (text or binary).\n"
+              << "  --analyze: (Optional) Check commands files and estimate their run time, key events and app actions\n"
+              << "      with the given --intervalMs and --speed, without running them.\n"
+              << "  --checkpoint[=<file>]: (Optional) Save the progress of each commands file every 10 seconds, to\n"
+              << "      <commands_file>.checkpoint or the given file. The checkpoint is removed when the file succeeds.\n"
+              << "  --resume: (Optional) Continue commands files from their checkpoints. Implies --checkpoint.\n"
+              << "  --shard: (Optional) Split each commands file into shards at its shard markers, or by the\n"
+              << "      iterations of its final loop, and run them concurrently on the --parallel devices.\n"
+              << "  --watch: (Optional) Run a commands file again whenever it or a file it includes is saved, until\n"
+              << "      stopped with Ctrl-C. A run in progress is finished first; press Ctrl-C again to end it.\n";
 }
 
 int main(int argc, char *argv[]) {
-    if (argc < 2 || argc > 4) {
+    if (argc < 2) {
         printUsage();
         return 1;
     }
 
-    std::string commandsFile;
+    std::vector<std::string> commandsFiles;
     std::string recordFile;
+    std::string convertFile;
+    std::string keymapFile;
+    std::vector<std::string> remapRules;
     int intervalMs = 100;
+    size_t parallel = 1;
+    double speed = 1.0;
+    bool simulate = false;
+    bool analyze = false;
+    bool watch = false;
+    RunOptions runOptions;
+    std::string traceFile;
+    RecordOptions recordOptions;
 
     // Parse command-line arguments
     for (int i = 1; i < argc; ++i) {
@@ -78,22 +128,120 @@ int main(int argc, char *argv[]) {
                 logError(e.what());
                 return 1;
             }
+        } else if (arg.find("--speed=") == 0) {
+            std::istringstream iss(arg.substr(8));
+            if (!(iss >> speed) || speed <= 0) {
+                logError("Invalid value for --speed. Must be a positive number.");
+                return 1;
+            }
+            logInfo("Replay speed factor set to " + arg.substr(8) + ".");
+        } else if (arg.find("--debounceMs=") == 0) {
+            std::string value = arg.substr(13);
+            std::string device;
+            auto separator = value.rfind('=');
+            if (separator != std::string::npos) {
+                device = value.substr(0, separator);
+                value = value.substr(separator + 1);
+            }
+            int debounceMs = -1;
+            std::istringstream iss(value);
+            if (!(iss >> debounceMs) || debounceMs < 0) {
+                logError("Invalid value for --debounceMs. Must be a non-negative integer.");
+                return 1;
+            }
+            if (device.empty()) {
+                recordOptions.debounceMs = debounceMs;
+            } else {
+                recordOptions.deviceDebounceMs[device] = debounceMs;
+            }
+        } else if (arg.find("--device=") == 0) {
+            try {
+                recordOptions.deviceFilter.addRule(arg.substr(9));
+            } catch (const std::exception &e) {
+                logError(e.what());
+                return 1;
+            }
+        } else if (arg.find("--recordFormat=") == 0) {
+            std::string format = arg.substr(15);
+            recordOptions.rawEvents = format == "raw";
+            if (format == "binary" || format == "raw") {
+                recordOptions.format = RecordFormat::Binary;
+            } else if (format == "text") {
+                recordOptions.format = RecordFormat::Text;
+            } else {
+                logError("Invalid value for --recordFormat. Values: text, binary, raw.");
+                return 1;
+            }
+        } else if (arg == "--mirror") {
+            recordOptions.mirror = true;
+        } else if (arg.find("--remap=") == 0) {
+            remapRules.push_back(arg.substr(8));
+        } else if (arg.find("--keymap=") == 0) {
+            keymapFile = arg.substr(9);
+        } else if (arg.find("--convert=") == 0) {
+            convertFile = arg.substr(10);
         } else if (arg.find("--record=") == 0) {
             recordFile = arg.substr(9);
             logInfo("Record mode enabled. Output file: " + recordFile);
+        } else if (arg == "--simulate" || arg.find("--simulate=") == 0) {
+            simulate = true;
+            traceFile = arg.size() > 11 ? arg.substr(11) : std::string();
+        } else if (arg == "--checkpoint" || arg.find("--checkpoint=") == 0) {
+            runOptions.checkpoints = true;
+            runOptions.checkpointFile = arg.size() > 13 ? arg.substr(13) : std::string();
+        } else if (arg == "--resume") {
+            runOptions.checkpoints = true;
+            runOptions.resume = true;
+        } else if (arg == "--analyze") {
+            analyze = true;
+        } else if (arg == "--shard") {
+            runOptions.shard = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg.find("--parallel=") == 0) {
+            std::istringstream iss(arg.substr(11));
+            if (!(iss >> parallel) || parallel < 1) {
+                logError("Invalid value for --parallel. Must be a positive integer.");
+                return 1;
+            }
         } else {
-            commandsFile = arg;
+            commandsFiles.push_back(arg);
         }
     }
 
+    std::string commandsFile = commandsFiles.empty() ? std::string() : commandsFiles.front();
+
+    if (!keymapFile.empty()) {
+        try {
+            KeyMap::loadProfile(keymapFile);
+        } catch (const std::exception &e) {
+            logError(e.what());
+            return 1;
+        }
+    }
+
+    // Remap rules name keys, so they are resolved once any key map profile is loaded
+    KeyMap keyMap;
+    for (const auto &rule : remapRules) {
+        auto separator = rule.find('=');
+        int from = separator != std::string::npos ? keyMap.getKeyCode(rule.substr(0, separator)) : -1;
+        int to = separator != std::string::npos ? keyMap.getKeyCode(rule.substr(separator + 1)) : -1;
+        if (from < 0 || to < 0) {
+            logError("Invalid value for --remap: " + rule + ". Expected <from_key>=<to_key>.");
+            return 1;
+        }
+        recordOptions.mirrorKeyMap[from] = to;
+    }
+
     KeyManager keyManager(intervalMs);
 
-    // Record mode
-    if (!recordFile.empty()) {
+    // Record and mirror mode
+    if (!recordFile.empty() || recordOptions.mirror) {
         std::signal(SIGINT, handleSignal);
         try {
-            keyManager.startRecording(recordFile);
-            std::cout << "\n\nRecording IR key events. Press Ctrl+C to stop.\n\n" << std::endl;
+            keyManager.startRecording(recordFile, recordOptions);
+            std::cout << "\n\n" << (recordFile.empty() ? "Mirroring" : "Recording")
+                      << " key events. Press Ctrl+C to stop.\n\n" << std::endl;
             while (isRecordingActive) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(500));
             }
@@ -110,34 +258,174 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Command execution mode
-    logInfo("Starting in execution mode with commands file: " + commandsFile);
+    // Conversion mode: the positional argument names the commands file to write
+    if (!convertFile.empty()) {
+        try {
+            keyManager.convertCapture(convertFile, commandsFile);
+            return 0;
+        } catch (const std::exception &e) {
+            logError("Error during conversion: " + std::string(e.what()));
+            return 1;
+        }
+    }
+
+    // Analysis mode: commands files are checked and simulated, never run
+    if (analyze) {
+        ScriptAnalyzer analyzer(intervalMs, speed);
+        size_t valid = 0;
+        int64_t totalMs = 0;
+        for (const auto &file : commandsFiles) {
+            ScriptAnalysis analysis = analyzer.analyze(file);
+            for (const auto &problem : analysis.problems) {
+                logError(file + ": " + problem);
+            }
+            if (!analysis.problems.empty()) {
+                logError("INVALID " + file + " (" + std::to_string(analysis.problems.size()) + " problem(s))");
+                continue;
+            }
+            ++valid;
+            totalMs += analysis.durationMs;
+            logInfo("OK " + file + ": durationMs=" + std::to_string(analysis.durationMs) +
+                    " keyEvents=" + std::to_string(analysis.keyEvents) +
+                    " appActions=" + std::to_string(analysis.appActions) +
+                    " commands=" + std::to_string(analysis.commandCount));
+        }
+        if (commandsFiles.size() > 1) {
+            logInfo(std::to_string(valid) + " of " + std::to_string(commandsFiles.size()) +
+                    " commands files are valid; together they run for " + std::to_string(totalMs) + "ms.");
+        }
+        return valid == commandsFiles.size() ? 0 : 1;
+    }
+
+    // Binary captures are replayed directly from the mapped file without parsing
+    if (CaptureFile::isCaptureFile(commandsFile)) {
+        if (simulate) {
+            logError("Capture files cannot be simulated; they already hold the timeline of their events.");
+            return 1;
+        }
+        logInfo("Replaying capture file: " + commandsFile);
+        try {
+            keyManager.replayCapture(commandsFile, speed);
+            return 0;
+        } catch (const std::exception &e) {
+            logError("Error during replay: " + std::string(e.what()));
+            return 1;
+        }
+    }
 
-    std::unordered_map<std::string, std::string> variables;
-    auto commandExecutor = std::make_shared<CommandExecutor>(variables);
+    // Command execution mode; simulated runs send their events to a SimulatedOutput instead of a device
+    EventManager::setListenDeviceFilter(recordOptions.deviceFilter);
+    if (!runOptions.checkpointFile.empty() && commandsFiles.size() > 1) {
+        logError("A checkpoint file can only be given for a single commands file.");
+        return 1;
+    }
+    if (!runOptions.checkpointFile.empty() && runOptions.shard) {
+        logError("Shards are checkpointed to files of their own; use --checkpoint without a file.");
+        return 1;
+    }
+    if (simulate && runOptions.checkpoints) {
+        logError("Simulated runs take no time and cannot be checkpointed.");
+        return 1;
+    }
+    runOptions.intervalMs = intervalMs;
+    runOptions.speed = speed;
+    std::shared_ptr<SimulatedOutput> &simulation = runOptions.simulation;
+    if (simulate) {
+        simulation = std::make_shared<SimulatedOutput>(!traceFile.empty());
+        logInfo("Simulating in virtual time; no events are sent.");
+    }
+    auto finishSimulation = [&]() {
+        if (!simulation) {
+            return true;
+        }
+        simulation->logSummary();
+        if (traceFile.empty()) {
+            return true;
+        }
+        try {
+            simulation->writeTrace(traceFile, recordOptions.format);
+            return true;
+        } catch (const std::exception &e) {
+            logError("Error writing simulated events: " + std::string(e.what()));
+            return false;
+        }
+    };
 
-    commandExecutor->registerCommand("var", std::make_shared<VariableExecutor>(variables));
-    commandExecutor->registerCommand("key_press", std::make_shared<KeyPressExecutor>(keyManager));
+    if (watch) {
+        if (commandsFiles.size() != 1 || simulate || runOptions.shard || runOptions.resume) {
+            logError("--watch runs a single commands file and cannot be combined with --simulate, --shard or "
+                     "--resume.");
+            return 1;
+        }
+        logInfo("Starting in watch mode with commands file: " + commandsFile);
+        std::signal(SIGINT, handleWatchSignal);
+        std::signal(SIGTERM, handleWatchSignal);
+        try {
+            ScriptRunner(runOptions).watch(commandsFile, stopWatching);
+        } catch (const std::exception &e) {
+            logError(e.what());
+            return 1;
+        }
+        logInfo("Stopped watching " + commandsFile + ".");
+        return 0;
+    }
 
-    auto loopExecutor = std::make_shared<LoopExecutor>(commandExecutor);
-    commandExecutor->registerCommand("loop_start", loopExecutor);
-    commandExecutor->registerCommand("loop_end", loopExecutor);
+    if (commandsFiles.size() == 1 && !runOptions.shard) {
+        logInfo("Starting in execution mode with commands file: " + commandsFile);
+        bool succeeded = ScriptRunner(runOptions).run(commandsFile).succeeded;
+        return finishSimulation() && succeeded ? 0 : 1;
+    }
 
-    auto appExecutor = std::make_shared<AppExecutor>();
-    commandExecutor->registerCommand("launch_app", appExecutor);
-    commandExecutor->registerCommand("close_app", appExecutor);
+    size_t workers = runOptions.shard ? parallel : std::min(parallel, commandsFiles.size());
+    logInfo("Running " + std::to_string(commandsFiles.size()) + " commands files on " + std::to_string(workers) +
+            " worker(s).");
+    EventManager::setOutputDeviceCount(workers);
 
-    commandExecutor->registerCommand("wait", std::make_shared<WaitExecutor>());
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ScriptResult> results = ScriptRunner::runParallel(commandsFiles, workers, runOptions);
+    auto elapsedMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
 
-    CommandHandler commandHandler(commandExecutor);
+    size_t succeeded = 0;
+    for (const auto &result : results) {
+        std::string line = (result.succeeded ? "PASS " : "FAIL ") + result.getName() + " (" +
+                           std::to_string(result.durationMs) + "ms)";
+        if (result.succeeded) {
+            ++succeeded;
+            logInfo(line);
+        } else {
+            logError(line + ": " + result.error);
+        }
+    }
 
-    try {
-        commandHandler.parseFile(commandsFile);
-        commandHandler.executeCommands();
-    } catch (const std::exception &e) {
-        logError("Error during execution: " + std::string(e.what()));
-        return 1;
+    if (runOptions.shard) {
+        // Merge the shards of each file; a file passes if all of its shards do
+        size_t succeededFiles = 0;
+        for (size_t i = 0; i < results.size();) {
+            size_t shards = 0;
+            size_t succeededShards = 0;
+            int64_t longestMs = 0;
+            const std::string &file = results[i].commandsFile;
+            for (; i < results.size() && results[i].commandsFile == file; ++i, ++shards) {
+                succeededShards += results[i].succeeded ? 1 : 0;
+                longestMs = std::max(longestMs, results[i].durationMs);
+            }
+            std::string line = file + ": " + std::to_string(succeededShards) + " of " + std::to_string(shards) +
+                               " shards succeeded; longest shard " + std::to_string(longestMs) + "ms.";
+            if (succeededShards == shards) {
+                ++succeededFiles;
+                logInfo(line);
+            } else {
+                logError(line);
+            }
+        }
+        logInfo(std::to_string(succeededFiles) + " of " + std::to_string(commandsFiles.size()) +
+                " commands files succeeded in " + std::to_string(elapsedMs) + "ms.");
+        return finishSimulation() && succeededFiles == commandsFiles.size() ? 0 : 1;
     }
 
-    return 0;
+    logInfo(std::to_string(succeeded) + " of " + std::to_string(results.size()) + " commands files succeeded in " +
+            std::to_string(elapsedMs) + "ms.");
+
+    return finishSimulation() && succeeded == results.size() ? 0 : 1;
 }
@@ -0,0 +1,69 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HttpRequester.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+// Nothing listens on port 1, so curl fails at once.
+const char *const RefusedUrl = "http://127.0.0.1:1/";
+
+class HttpRequesterTest : public ::testing::Test {
+protected:
+    /**
+     * Posts a request and waits for its listener.
+     *
+     * @return The status passed to the listener.
+     */
+    int postAndWait(const std::string &url) {
+        HttpRequester::getInstance().post(url, [this](int status) {
+            std::lock_guard<std::mutex> lock(mutex);
+            statuses.push_back(status);
+            completed.notify_one();
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        EXPECT_TRUE(completed.wait_for(lock, std::chrono::seconds(10), [this]() { return !statuses.empty(); }));
+        return statuses.empty() ? 0 : statuses.back();
+    }
+
+    std::mutex mutex;
+    std::condition_variable completed;
+    std::vector<int> statuses;
+};
+} // namespace
+
+TEST_F(HttpRequesterTest, ReportsAFailedRequest) { EXPECT_NE(postAndWait(RefusedUrl), 0); }
+
+TEST_F(HttpRequesterTest, DoesNotCallTheListenerOfACancelledRequest) {
+    bool called = false;
+    size_t requestId = HttpRequester::getInstance().post(RefusedUrl, [&called](int) { called = true; });
+    HttpRequester::getInstance().cancel(requestId);
+
+    // Requests are sent in order, so the cancelled one has been dealt with once this completes.
+    postAndWait(RefusedUrl);
+    EXPECT_FALSE(called);
+    EXPECT_EQ(statuses.size(), 1u);
+}
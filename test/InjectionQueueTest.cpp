@@ -0,0 +1,159 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "InjectionQueue.h"
+#include "Scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr size_t ReportsPerProducer = 1000;
+
+/**
+ * Pushes reports from many producer threads at once, each to an output device of its own, and
+ * checks that each report arrives exactly once and in the order its producer sent it. Beyond
+ * LaneCount producers share lanes.
+ */
+void checkDelivery(size_t producers) {
+    InjectionQueue queue;
+    std::atomic<bool> consuming{true};
+    std::vector<size_t> received(producers, 0);
+    bool inOrder = true;
+
+    std::thread consumer([&]() {
+        auto deliver = [&](const InjectionReport &report) {
+            size_t producer = report.outputDevice;
+            inOrder = inOrder && static_cast<size_t>(report.events[0].keyCode) == received[producer];
+            ++received[producer];
+        };
+        while (consuming) {
+            if (queue.drain(deliver) == 0) {
+                queue.wait(10);
+            }
+        }
+        queue.drain(deliver);
+    });
+
+    std::vector<std::thread> threads;
+    for (size_t producer = 0; producer < producers; ++producer) {
+        threads.emplace_back([&, producer]() {
+            for (size_t i = 0; i < ReportsPerProducer; ++i) {
+                InjectionReport report;
+                report.outputDevice = static_cast<uint16_t>(producer);
+                report.count = 1;
+                report.events[0] = {1, static_cast<int>(i)};
+                queue.push(report);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    consuming = false;
+    queue.wake();
+    consumer.join();
+
+    EXPECT_TRUE(inOrder);
+    for (size_t producer = 0; producer < producers; ++producer) {
+        EXPECT_EQ(received[producer], ReportsPerProducer) << "producer " << producer;
+    }
+}
+
+/**
+ * Sends one report per step to one output device, as a script does. Every third step it holds
+ * its worker for a moment after scheduling the next one, so the steps move between workers in
+ * uneven runs.
+ */
+class SendingTask : public Scheduler::Task {
+public:
+    static constexpr size_t Steps = 64;
+
+    explicit SendingTask(InjectionQueue &queue) : queue(queue) {}
+
+    void resume(Scheduler &scheduler) override {
+        InjectionReport report;
+        report.outputDevice = 3;
+        report.count = 1;
+        report.events[0] = {1, static_cast<int>(step)};
+        queue.push(report);
+
+        bool holdWorker = step % 3 == 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        workers.insert(std::this_thread::get_id());
+        if (++step == Steps) {
+            finished.notify_one();
+            return;
+        }
+        lock.unlock();
+
+        scheduler.schedule(*this);
+        if (holdWorker) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+
+    void waitUntilFinished() {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this]() { return step == Steps; });
+    }
+
+    size_t getWorkerCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return workers.size();
+    }
+
+private:
+    InjectionQueue &queue;
+    size_t step = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::set<std::thread::id> workers;
+};
+} // namespace
+
+TEST(InjectionQueueTest, DeliversReportsOfEachProducerInOrder) { checkDelivery(4); }
+
+TEST(InjectionQueueTest, DeliversFromMoreProducersThanLanes) { checkDelivery(InjectionQueue::LaneCount * 2 + 1); }
+
+TEST(InjectionQueueTest, KeepsTheOrderOfATaskResumedOnSeveralWorkers) {
+    InjectionQueue queue;
+    SendingTask task(queue);
+    {
+        Scheduler scheduler(2);
+        scheduler.schedule(task);
+        task.waitUntilFinished();
+    }
+    EXPECT_EQ(task.getWorkerCount(), 2u);
+
+    // Delivered only now, as by an injector that has fallen behind.
+    std::vector<int> delivered;
+    queue.drain([&](const InjectionReport &report) { delivered.push_back(report.events[0].keyCode); });
+    ASSERT_EQ(delivered.size(), SendingTask::Steps);
+    for (size_t i = 0; i < delivered.size(); ++i) {
+        EXPECT_EQ(delivered[i], static_cast<int>(i));
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KeyProfile.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+class KeyProfileTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/otto-profile-XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        directory = pattern;
+        profilePath = directory + "/remote.keys";
+        std::ofstream(profilePath) << "# test remote\nok 28\nback 14\nnetflix 0x1a2\nhome KEY_HOME\n";
+    }
+
+    KeyProfile load() {
+        return KeyProfile(profilePath, [](const std::string &name) { return name == "KEY_HOME" ? 102 : -1; });
+    }
+
+    void expectProfile(const KeyProfile &profile) {
+        EXPECT_EQ(profile.size(), 4u);
+        EXPECT_EQ(profile.findCode("ok"), 28);
+        EXPECT_EQ(profile.findCode("netflix"), 0x1a2);
+        EXPECT_EQ(profile.findCode("home"), 102);
+        EXPECT_EQ(profile.findCode("menu"), -1);
+        EXPECT_EQ(profile.findName(14), "back");
+    }
+
+    std::vector<std::string> listDirectory() {
+        std::vector<std::string> names;
+        DIR *dir = opendir(directory.c_str());
+        while (struct dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        return names;
+    }
+
+    std::string directory;
+    std::string profilePath;
+};
+} // namespace
+
+TEST_F(KeyProfileTest, WritesTheCacheWithoutLeavingTemporaryFiles) {
+    expectProfile(load());
+    auto names = listDirectory();
+    std::sort(names.begin(), names.end());
+    EXPECT_EQ(names, (std::vector<std::string>{"remote.keys", "remote.keys.cache"}));
+    expectProfile(load());
+}
+
+TEST_F(KeyProfileTest, IgnoresACacheWhoseTablesDisagree) {
+    load();
+    std::string cachePath = profilePath + ".cache";
+    struct stat st {};
+    ASSERT_EQ(stat(cachePath.c_str(), &st), 0);
+
+    // Point every hash slot at the first entry, keeping all indices in range.
+    std::fstream cache(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    std::vector<char> content(static_cast<size_t>(st.st_size));
+    cache.read(content.data(), st.st_size);
+    size_t slotsEnd = content.size() - (0x1a2 + 1) * sizeof(int16_t);
+    size_t slotsStart = slotsEnd - 8 * sizeof(int16_t);
+    for (size_t offset = slotsStart; offset < slotsEnd; offset += sizeof(int16_t)) {
+        content[offset] = 0;
+        content[offset + 1] = 0;
+    }
+    cache.seekp(0);
+    cache.write(content.data(), st.st_size);
+    cache.close();
+
+    expectProfile(load());
+}
@@ -0,0 +1,87 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "LogWatcher.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+
+namespace {
+class LogWatcherTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/otto-logwatch-XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        logFile = std::string(pattern) + "/app.log";
+        std::ofstream(logFile) << "started\n";
+    }
+
+    void TearDown() override { LogWatcher::getInstance().removeWatch(watchId); }
+
+    void watch(const std::string &regex) {
+        watchId = LogWatcher::getInstance().addWatch(logFile, std::make_shared<const std::regex>(regex),
+                                                     [this](bool matched, const std::string &line) {
+                                                         std::lock_guard<std::mutex> lock(mutex);
+                                                         this->matched = matched;
+                                                         matchedLine = line;
+                                                         done = true;
+                                                         condition.notify_one();
+                                                     });
+    }
+
+    void append(const std::string &text) { std::ofstream(logFile, std::ios::app) << text; }
+
+    bool waitForMatch() {
+        std::unique_lock<std::mutex> lock(mutex);
+        return condition.wait_for(lock, std::chrono::seconds(5), [this]() { return done; }) && matched;
+    }
+
+    std::string logFile;
+    size_t watchId = 0;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool done = false;
+    bool matched = false;
+    std::string matchedLine;
+};
+} // namespace
+
+TEST_F(LogWatcherTest, MatchesAfterTextWithoutNewlines) {
+    watch("^READY$");
+    append(std::string(1024 * 1024, 'x'));
+    append("\nREADY\n");
+    ASSERT_TRUE(waitForMatch());
+    EXPECT_EQ(matchedLine, "READY");
+}
+
+TEST_F(LogWatcherTest, MatchesTheStartOfAnOverlongLine) {
+    watch("^BEGIN x");
+    append("BEGIN " + std::string(1024 * 1024, 'x') + "\n");
+    ASSERT_TRUE(waitForMatch());
+    EXPECT_LT(matchedLine.size(), 1024u * 1024u);
+    EXPECT_EQ(matchedLine.compare(0, 6, "BEGIN "), 0);
+}
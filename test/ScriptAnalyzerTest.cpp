@@ -0,0 +1,52 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Logger.h"
+#include "ScriptAnalyzer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ScriptAnalyzerTest, QuietensTheSimulatedRunOnly) {
+    LoggerConfig::setLogLevel(LogLevel::INFO);
+    std::vector<std::vector<std::string>> commands = {
+        {"wait_for_key", "KEY_A"}, {"parallel_start"}, {"wait_for_key", "KEY_B"}, {"branch"},
+        {"key_press", "KEY_C"},    {"parallel_end"},
+    };
+
+    testing::internal::CaptureStdout();
+    setLogContext("caller");
+    ScriptAnalysis analysis;
+    std::thread analyzing([&]() { analysis = ScriptAnalyzer(50, 1.0).analyze("quiet", commands); });
+    logInfo("Logged while analyzing.");
+    analyzing.join();
+    ScriptAnalyzer(50, 1.0).analyze("quiet", commands);
+    logInfo("Logged after analyzing.");
+    setLogContext("");
+    std::string output = testing::internal::GetCapturedStdout();
+
+    EXPECT_TRUE(analysis.problems.empty());
+    EXPECT_EQ(output.find("Simulated key"), std::string::npos) << output;
+    EXPECT_NE(output.find("[caller] Logged while analyzing."), std::string::npos) << output;
+    EXPECT_NE(output.find("[caller] Logged after analyzing."), std::string::npos) << output;
+    EXPECT_EQ(LoggerConfig::currentLevel, LogLevel::INFO);
+}
@@ -0,0 +1,91 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "KeyMap.h"
+#include "RecordWriter.h"
+#include "ScriptEncoder.h"
+#include "ScriptRunner.h"
+#include "SimulatedOutput.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <linux/input-event-codes.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+InputRecord keyRecord(int64_t timeMs, uint16_t code, int32_t value) {
+    InputRecord record{};
+    record.timestampUs = timeMs * 1000;
+    record.type = INPUT_TYPE_KEY;
+    record.code = code;
+    record.value = value;
+    return record;
+}
+
+std::string readFile(const std::string &path) {
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+} // namespace
+
+TEST(ScriptEncoderTest, RecordsOverlappingKeysAsDownAndUp) {
+    KeyMap keyMap;
+    ScriptEncoder encoder(keyMap);
+    std::string script;
+    for (const auto &record : {keyRecord(0, KEY_LEFTCTRL, INPUT_PRESS), keyRecord(50, KEY_C, INPUT_PRESS),
+                               keyRecord(150, KEY_C, INPUT_RELEASE), keyRecord(200, KEY_LEFTCTRL, INPUT_RELEASE),
+                               keyRecord(400, KEY_A, INPUT_PRESS), keyRecord(450, KEY_A, INPUT_RELEASE)}) {
+        encoder.encode(record, script);
+    }
+    encoder.finish(script);
+
+    EXPECT_EQ(script, "key_down KEY_LEFTCTRL\nwait 50ms\nkey_down KEY_C\nwait 100ms\nkey_up KEY_C\nwait 50ms\n"
+                      "key_up KEY_LEFTCTRL\nwait 200ms\nkey_press KEY_A\n");
+}
+
+TEST(ScriptEncoderTest, ReplaysARecordedChordAsRecorded) {
+    KeyMap keyMap;
+    ScriptEncoder encoder(keyMap);
+    std::string script = encoder.header();
+    for (const auto &record : {keyRecord(0, KEY_LEFTCTRL, INPUT_PRESS), keyRecord(50, KEY_C, INPUT_PRESS),
+                               keyRecord(50, KEY_V, INPUT_PRESS), keyRecord(150, KEY_C, INPUT_RELEASE),
+                               keyRecord(150, KEY_V, INPUT_RELEASE), keyRecord(200, KEY_LEFTCTRL, INPUT_RELEASE)}) {
+        encoder.encode(record, script);
+    }
+    encoder.finish(script);
+
+    char directory[] = "/tmp/otto-encoder-XXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    std::string scriptFile = std::string(directory) + "/recorded.txt";
+    std::string traceFile = std::string(directory) + "/replayed.txt";
+    std::ofstream(scriptFile) << script;
+
+    // Replaying the recording must send the same transitions at the same times.
+    RunOptions options;
+    options.simulation = std::make_shared<SimulatedOutput>(true);
+    ASSERT_TRUE(ScriptRunner(options).run(scriptFile).succeeded);
+    options.simulation->writeTrace(traceFile, RecordFormat::Text);
+    EXPECT_EQ(readFile(traceFile), script);
+}
@@ -0,0 +1,105 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EventManager.h"
+#include "InjectionQueue.h"
+#include "ScriptRunner.h"
+#include "SimulatedOutput.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ * Writes the same script to count files in a new temporary directory.
+ */
+std::vector<std::string> writeScripts(size_t count, const std::string &script) {
+    char directory[] = "/tmp/otto-runner-XXXXXX";
+    if (!mkdtemp(directory)) {
+        ADD_FAILURE() << "Could not create a temporary directory";
+        return {};
+    }
+    std::vector<std::string> files;
+    for (size_t i = 0; i < count; ++i) {
+        files.push_back(std::string(directory) + "/script" + std::to_string(i) + ".txt");
+        std::ofstream(files.back()) << script;
+    }
+    return files;
+}
+
+/**
+ * Waits up to five seconds for a condition.
+ */
+template <typename Condition> bool eventually(Condition condition) {
+    for (int i = 0; i < 500 && !condition(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+void expectAllSucceeded(const std::vector<ScriptResult> &results, size_t count) {
+    ASSERT_EQ(results.size(), count);
+    for (const auto &result : results) {
+        EXPECT_TRUE(result.succeeded) << result.commandsFile << ": " << result.error;
+    }
+}
+} // namespace
+
+TEST(ScriptRunnerTest, RunsOnMoreDevicesThanInjectionLanes) {
+    size_t devices = InjectionQueue::LaneCount + 4;
+    auto files = writeScripts(devices * 2, "wait 20ms\nloop_start 2\nwait 10ms\nloop_end\n");
+    expectAllSucceeded(ScriptRunner::runParallel(files, devices, RunOptions()), files.size());
+}
+
+TEST(ScriptRunnerTest, SendsKeysToMoreDevicesThanInjectionLanes) {
+    if (access("/dev/uinput", W_OK) != 0) {
+        GTEST_SKIP() << "Sending keys needs /dev/uinput";
+    }
+    size_t devices = InjectionQueue::LaneCount + 4;
+    EventManager::setOutputDeviceCount(devices);
+    auto files = writeScripts(devices, "key_press ok\nkey_combo home 0\nkey_press down 3\n");
+    RunOptions options;
+    options.intervalMs = 10;
+    expectAllSucceeded(ScriptRunner::runParallel(files, devices, options), files.size());
+}
+
+TEST(ScriptRunnerTest, WatchRunsAgainWhenTheScriptIsSavedUntilStopped) {
+    auto files = writeScripts(1, "key_press KEY_A\n");
+    RunOptions options;
+    options.simulation = std::make_shared<SimulatedOutput>();
+    std::atomic<bool> stop{false};
+    std::thread watcher([&]() { ScriptRunner(options).watch(files[0], stop); });
+
+    // Each run of the script presses and releases its keys once.
+    EXPECT_TRUE(eventually([&]() { return options.simulation->getEventCount() == 2; }));
+    std::ofstream(files[0], std::ios::app) << "key_press KEY_B\n";
+    EXPECT_TRUE(eventually([&]() { return options.simulation->getEventCount() == 6; }));
+
+    stop = true;
+    watcher.join();
+    EXPECT_EQ(options.simulation->getEventCount(), 6u);
+}
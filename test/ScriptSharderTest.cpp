@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptSharder.h"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+using Commands = ScriptSharder::Commands;
+
+TEST(ScriptSharderTest, SplitsTheFinalTopLevelLoop) {
+    Commands commands = {{"loop_start", "2"}, {"key_press", "home"}, {"loop_end"}, {"wait", "1s"},
+                         {"loop_start", "8"}, {"key_press", "down"}, {"loop_end"}};
+
+    auto shards = ScriptSharder::split(commands, 3);
+
+    ASSERT_EQ(shards.size(), 3u);
+    const char *iterations[] = {"3", "3", "2"};
+    for (size_t i = 0; i < shards.size(); ++i) {
+        Commands expected = {{"loop_start", "2"}, {"key_press", "home"}, {"loop_end"}, {"wait", "1s"},
+                             {"loop_start", iterations[i]}, {"key_press", "down"}, {"loop_end"}};
+        EXPECT_EQ(shards[i], expected) << "shard " << i + 1;
+    }
+}
+
+TEST(ScriptSharderTest, SplitsAtMarkersAfterThePrelude) {
+    Commands commands = {{"key_press", "home"}, {"shard"}, {"wait", "3s"}, {"shard"}, {"shard"}, {"wait", "1s"}};
+
+    auto shards = ScriptSharder::split(commands, 8);
+
+    ASSERT_EQ(shards.size(), 2u);
+    EXPECT_EQ(shards[0], (Commands{{"key_press", "home"}, {"wait", "3s"}}));
+    EXPECT_EQ(shards[1], (Commands{{"key_press", "home"}, {"wait", "1s"}}));
+}
+
+TEST(ScriptSharderTest, RejectsCommandsAfterTheFinalLoop) {
+    Commands commands = {{"loop_start", "4"}, {"key_press", "down"}, {"loop_end"}, {"key_press", "home"}};
+    EXPECT_THROW(ScriptSharder::split(commands, 2), std::runtime_error);
+}
+
+TEST(ScriptSharderTest, RejectsMarkersInsideBlocks) {
+    Commands commands = {{"loop_start", "2"}, {"shard"}, {"loop_end"}};
+    EXPECT_THROW(ScriptSharder::split(commands, 2), std::runtime_error);
+}
@@ -0,0 +1,73 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2024 Sky UK
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RecordWriter.h"
+#include "ScriptRunner.h"
+#include "SimulatedOutput.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace {
+class SimulatedOutputTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        char pattern[] = "/tmp/otto-simulate-XXXXXX";
+        ASSERT_NE(mkdtemp(pattern), nullptr);
+        directory = pattern;
+    }
+
+    /**
+     * Simulates a script and returns the text trace of the events it sent.
+     */
+    std::string trace(const std::string &script, bool keepTrace = true) {
+        std::string scriptFile = directory + "/script.txt";
+        std::string traceFile = directory + "/trace.txt";
+        std::ofstream(scriptFile) << script;
+
+        RunOptions options;
+        options.simulation = std::make_shared<SimulatedOutput>(keepTrace);
+        EXPECT_TRUE(ScriptRunner(options).run(scriptFile).succeeded);
+        eventCount = options.simulation->getEventCount();
+        options.simulation->writeTrace(traceFile, RecordFormat::Text);
+
+        std::ifstream file(traceFile);
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    std::string directory;
+    size_t eventCount = 0;
+};
+} // namespace
+
+TEST_F(SimulatedOutputTest, TracesShiftedCharactersAsChords) {
+    EXPECT_EQ(trace("type_text \"Hi\"\n"), "timeline absolute\nkey_down KEY_LEFTSHIFT KEY_H\nwait 50ms\n"
+                                           "key_up KEY_LEFTSHIFT KEY_H\nwait 50ms\nkey_press KEY_I\n");
+}
+
+TEST_F(SimulatedOutputTest, CountsEventsWithoutKeepingThem) {
+    EXPECT_EQ(trace("loop_start 50\nkey_press KEY_A\nloop_end\n", false), "timeline absolute\n");
+    EXPECT_EQ(eventCount, 100u);
+}